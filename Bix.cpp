@@ -0,0 +1,98 @@
+/*
+* Copyright 2005-2017 Rochus Keller <mailto:me@rochus-keller.info>
+*
+* This file is part of the DoorScope Sdb library.
+*
+* The following is the license that applies to this copy of the
+* library. For a license to use the library under conditions
+* other than those described here, please email to me@rochus-keller.info.
+*
+* GNU General Public License Usage
+* This file may be used under the terms of the GNU General Public
+* License (GPL) versions 2.0 or 3.0 as published by the Free Software
+* Foundation and appearing in the file LICENSE.GPL included in
+* the packaging of this file. Please review the following information
+* to ensure GNU General Public Licensing requirements will be met:
+* http://www.fsf.org/licensing/licenses/info/GPLv2.html and
+* http://www.gnu.org/copyleft/gpl.html.
+*/
+
+#include "Bix.h"
+#include "Exceptions.h"
+#include "BtreeCursor.h"
+#include "Transaction.h"
+#include "OidSet.h"
+using namespace Sdb;
+using namespace Stream;
+
+Bix::Bix( Transaction* txn, Index idx ):d_txn(txn),d_idx(idx)
+{
+}
+
+void Bix::checkNull() const
+{
+	if( d_idx == 0 )
+		throw DatabaseException(DatabaseException::AccessRecord, "null");
+}
+
+void Bix::lookup( const QList<Stream::DataCell>& lo, const QList<Stream::DataCell>& hi, 
+				 int opts, OidSet::Bits& bits ) const
+{
+	visit( lo, hi, opts, &bits, 0 );
+}
+
+quint64 Bix::count( const QList<Stream::DataCell>& lo, const QList<Stream::DataCell>& hi, 
+				   int opts ) const
+{
+	quint64 n = 0;
+	visit( lo, hi, opts, 0, &n );
+	return n;
+}
+
+void Bix::visit( const QList<Stream::DataCell>& lo, const QList<Stream::DataCell>& hi, 
+				int opts, OidSet::Bits* bits, quint64* count ) const
+{
+	checkNull();
+	Database::Lock lock( d_txn->getDb(), false );
+	IndexMeta meta;
+	if( !d_txn->getDb()->getIndexMeta( d_idx, meta ) || meta.d_kind != IndexMeta::Bitmap )
+		throw DatabaseException( DatabaseException::WrongType, "not a bitmap index" );
+	const QByteArray loKey = Idx::makeBound( meta, lo );
+	const QByteArray hiKey = Idx::makeBound( meta, hi );
+	// Die Zeilen eines Werts sind nach Block sortiert, die Werte nach ihrer Kodierung
+	BtreeCursor c;
+	c.open( d_txn->getDb()->getStore(), d_idx );
+	c.moveTo( loKey, true );
+	if( c.isValidPos() ) do
+	{
+		const QByteArray k = c.readKey();
+		const QByteArray t = OidSet::termOf( k );
+		if( !Idx::belowHi( t, hiKey, opts ) )
+			break;
+		if( Idx::aboveLo( t, loKey, opts ) )
+		{
+			if( bits )
+				OidSet::decode( c.readValue(), *bits );
+			if( count )
+				*count += OidSet::count( c.readValue() );
+		}
+	}while( c.moveNext() );
+}
+
+QList<OID> Bix::find( const Stream::DataCell& v ) const
+{
+	return find( QList<Stream::DataCell>() << v );
+}
+
+QList<OID> Bix::find( const QList<Stream::DataCell>& key ) const
+{
+	return findRange( key, key, Idx::Inclusive );
+}
+
+QList<OID> Bix::findRange( const QList<Stream::DataCell>& lo, const QList<Stream::DataCell>& hi, 
+						  int opts ) const
+{
+	OidSet::Bits bits;
+	lookup( lo, hi, opts, bits );
+	return OidSet::toList( bits );
+}
@@ -0,0 +1,63 @@
+#ifndef __Sdb_Bix__
+#define __Sdb_Bix__
+
+/*
+* Copyright 2005-2017 Rochus Keller <mailto:me@rochus-keller.info>
+*
+* This file is part of the DoorScope Sdb library.
+*
+* The following is the license that applies to this copy of the
+* library. For a license to use the library under conditions
+* other than those described here, please email to me@rochus-keller.info.
+*
+* GNU General Public License Usage
+* This file may be used under the terms of the GNU General Public
+* License (GPL) versions 2.0 or 3.0 as published by the Free Software
+* Foundation and appearing in the file LICENSE.GPL included in
+* the packaging of this file. Please review the following information
+* to ensure GNU General Public Licensing requirements will be met:
+* http://www.fsf.org/licensing/licenses/info/GPLv2.html and
+* http://www.gnu.org/copyleft/gpl.html.
+
+#include <QList>
+#include <Stream/DataCell.h>
+#include <Sdb/Globals.h>
+#include <Sdb/Idx.h>
+#include <Sdb/OidSet.h>
+
+namespace Sdb
+{
+	class Transaction;
+
+	class Bix // Bitmap
+	{
+	public:
+		Bix( Transaction* = 0, Index idx = 0 );
+
+		// Die Werte werden wie im Index kodiert. Resultat sind aufsteigende Oids.
+		QList<OID> find( const Stream::DataCell& ) const;
+		QList<OID> find( const QList<Stream::DataCell>& key ) const; // Prfix ber die ersten Items
+		QList<OID> findRange( const QList<Stream::DataCell>& lo, const QList<Stream::DataCell>& hi, 
+			int opts = Idx::Inclusive ) const; // opts: Idx::ExcludeLo, Idx::ExcludeHi
+
+		bool isNull() const { return d_idx == 0; }
+		Transaction* getTxn() const { return d_txn; }
+		Index getIdx() const { return d_idx; }
+	protected:
+		friend class Query;
+		void checkNull() const;
+		// Vereinigt die Mengen aller Werte im Bereich in bits
+		void lookup( const QList<Stream::DataCell>& lo, const QList<Stream::DataCell>& hi, 
+			int opts, OidSet::Bits& bits ) const;
+		// Summe der Oids aller Werte im Bereich, ohne die Zeilen zu dekodieren
+		quint64 count( const QList<Stream::DataCell>& lo, const QList<Stream::DataCell>& hi, 
+			int opts ) const;
+	private:
+		void visit( const QList<Stream::DataCell>& lo, const QList<Stream::DataCell>& hi, 
+			int opts, OidSet::Bits* bits, quint64* count ) const;
+		Transaction* d_txn;
+		Index d_idx;
+	};
+}
+
+#endif
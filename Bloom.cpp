@@ -0,0 +1,90 @@
+/*
+* Copyright 2005-2017 Rochus Keller <mailto:me@rochus-keller.info>
+*
+* This file is part of the DoorScope Sdb library.
+*
+* The following is the license that applies to this copy of the
+* library. For a license to use the library under conditions
+* other than those described here, please email to me@rochus-keller.info.
+*
+* GNU General Public License Usage
+* This file may be used under the terms of the GNU General Public
+* License (GPL) versions 2.0 or 3.0 as published by the Free Software
+* Foundation and appearing in the file LICENSE.GPL included in
+* the packaging of this file. Please review the following information
+* to ensure GNU General Public Licensing requirements will be met:
+* http://www.fsf.org/licensing/licenses/info/GPLv2.html and
+* http://www.gnu.org/copyleft/gpl.html.
+*/
+
+#include "Bloom.h"
+using namespace Sdb;
+
+Bloom::Bloom( quint32 blocks ):d_count(0)
+{
+	if( blocks == 0 )
+		blocks = 1;
+	d_blocks.fill( QByteArray( BlockBytes, 0 ), blocks );
+}
+
+quint64 Bloom::hash( const QByteArray& key )
+{
+	// FNV-1a 64 Bit
+	quint64 h = Q_UINT64_C(14695981039346656037);
+	for( int i = 0; i < key.size(); i++ )
+	{
+		h ^= quint8( key[i] );
+		h *= Q_UINT64_C(1099511628211);
+	}
+	return h;
+}
+
+quint32 Bloom::blocksFor( quint64 keys )
+{
+	const quint64 bits = keys * BitsPerKey;
+	return qMax( quint64(1), ( bits + BlockBytes * 8 - 1 ) / ( BlockBytes * 8 ) );
+}
+
+bool Bloom::isOverloaded() const
+{
+	return d_count > 2 * quint64( d_blocks.size() ) * BlockBytes * 8 / BitsPerKey;
+}
+
+void Bloom::setBlock( quint32 i, const QByteArray& b )
+{
+	if( int(i) < d_blocks.size() && b.size() == BlockBytes )
+		d_blocks[i] = b;
+}
+
+quint32 Bloom::add( const QByteArray& key )
+{
+	// Doppeltes Hashing innerhalb des Blocks; der obere Teil whlt den Block
+	const quint64 h = hash( key );
+	const quint32 block = ( h >> 32 ) % d_blocks.size();
+	const quint32 h1 = quint32( h );
+	const quint32 h2 = quint32( h >> 32 ) | 1;
+	uchar* p = (uchar*)d_blocks[block].data();
+	for( int i = 0; i < Hashes; i++ )
+	{
+		const quint32 bit = ( h1 + i * h2 ) % ( BlockBytes * 8 );
+		p[bit >> 3] |= 1 << ( bit & 7 );
+	}
+	d_count++;
+	return block;
+}
+
+bool Bloom::mayContain( const QByteArray& key ) const
+{
+	const quint64 h = hash( key );
+	const quint32 block = ( h >> 32 ) % d_blocks.size();
+	const quint32 h1 = quint32( h );
+	const quint32 h2 = quint32( h >> 32 ) | 1;
+	const uchar* p = (const uchar*)d_blocks[block].constData();
+	for( int i = 0; i < Hashes; i++ )
+	{
+		const quint32 bit = ( h1 + i * h2 ) % ( BlockBytes * 8 );
+		if( ( p[bit >> 3] & ( 1 << ( bit & 7 ) ) ) == 0 )
+			return false;
+	}
+	return true;
+}
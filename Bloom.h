@@ -0,0 +1,58 @@
+#ifndef __Sdb_Bloom__
+#define __Sdb_Bloom__
+
+/*
+* Copyright 2005-2017 Rochus Keller <mailto:me@rochus-keller.info>
+*
+* This file is part of the DoorScope Sdb library.
+*
+* The following is the license that applies to this copy of the
+* library. For a license to use the library under conditions
+* other than those described here, please email to me@rochus-keller.info.
+*
+* GNU General Public License Usage
+* This file may be used under the terms of the GNU General Public
+* License (GPL) versions 2.0 or 3.0 as published by the Free Software
+* Foundation and appearing in the file LICENSE.GPL included in
+* the packaging of this file. Please review the following information
+* to ensure GNU General Public Licensing requirements will be met:
+* http://www.fsf.org/licensing/licenses/info/GPLv2.html and
+* http://www.gnu.org/copyleft/gpl.html.
+
+#include <QVector>
+#include <QByteArray>
+#include <Sdb/Globals.h>
+
+namespace Sdb
+{
+	// Interne Klasse
+	// Geblockter Bloom-Filter: jeder Key setzt seine Bits in genau einem Block, so dass 
+	// nach einem add nur dieser Block geschrieben werden muss. Ein negatives mayContain
+	// ist sicher, ein positives nur wahrscheinlich. Entfernen ist nicht mglich; der Filter
+	// wird neu aufgebaut, wenn mehr Keys hinzugefgt wurden als er fassen kann.
+
+	class Bloom
+	{
+	public:
+		enum { BlockBytes = 512, BitsPerKey = 10, Hashes = 7 };
+
+		Bloom( quint32 blocks = 1 );
+
+		quint32 add( const QByteArray& ); // Rckgabe: Nummer des genderten Blocks
+		bool mayContain( const QByteArray& ) const;
+
+		quint32 getBlockCount() const { return d_blocks.size(); }
+		const QByteArray& getBlock( quint32 i ) const { return d_blocks[i]; }
+		void setBlock( quint32, const QByteArray& );
+		quint64 getCount() const { return d_count; }
+		void setCount( quint64 c ) { d_count = c; }
+		bool isOverloaded() const; // mehr als doppelt so viele Keys wie vorgesehen
+		static quint32 blocksFor( quint64 keys );
+	private:
+		static quint64 hash( const QByteArray& );
+		QVector<QByteArray> d_blocks;
+		quint64 d_count; // Anzahl add seit dem Aufbau
+	};
+}
+
+#endif
@@ -0,0 +1,221 @@
+/*
+* Copyright 2005-2017 Rochus Keller <mailto:me@rochus-keller.info>
+*
+* This file is part of the DoorScope Sdb library.
+*
+* The following is the license that applies to this copy of the
+* library. For a license to use the library under conditions
+* other than those described here, please email to me@rochus-keller.info.
+*
+* GNU General Public License Usage
+* This file may be used under the terms of the GNU General Public
+* License (GPL) versions 2.0 or 3.0 as published by the Free Software
+* Foundation and appearing in the file LICENSE.GPL included in
+* the packaging of this file. Please review the following information
+* to ensure GNU General Public Licensing requirements will be met:
+* http://www.fsf.org/licensing/licenses/info/GPLv2.html and
+* http://www.gnu.org/copyleft/gpl.html.
+*/
+
+#include "BtreeBatch.h"
+#include "BtreeStore.h"
+#include "BtreeCursor.h"
+#include "OidSet.h"
+#include <QSet>
+#include <QtEndian>
+using namespace Sdb;
+
+static const int s_seekSteps = 8; // so viele moveNext vor einem neuen moveTo
+
+BtreeBatch::BtreeBatch():d_size(0)
+{
+}
+
+void BtreeBatch::insert( int table, const QByteArray& key, const QByteArray& value )
+{
+	Op& op = d_ops[table][key];
+	op.d_kind = Insert;
+	op.d_value = value;
+	d_size += key.size() + value.size();
+}
+
+void BtreeBatch::remove( int table, const QByteArray& key )
+{
+	Ops& ops = d_ops[table];
+	Ops::iterator i = ops.find( key );
+	if( i == ops.end() )
+	{
+		ops.insert( key, Op( Remove ) );
+		d_size += key.size();
+	}
+	// else: es gibt bereits ein insert oder remove, das Vorrang hat
+}
+
+void BtreeBatch::removeIf( int table, const QByteArray& key, const QByteArray& value )
+{
+	Ops& ops = d_ops[table];
+	Ops::iterator i = ops.find( key );
+	if( i == ops.end() )
+	{
+		Op& op = ops[key];
+		op.d_kind = RemoveIf;
+		op.d_value = value;
+		d_size += key.size() + value.size();
+	}
+}
+
+void BtreeBatch::addMember( int table, const QByteArray& key, OID id )
+{
+	Op& op = d_ops[table][key];
+	op.d_kind = Members;
+	op.d_members[id] = true;
+	d_size += key.size() + 8;
+}
+
+void BtreeBatch::removeMember( int table, const QByteArray& key, OID id )
+{
+	Op& op = d_ops[table][key];
+	op.d_kind = Members;
+	op.d_members[id] = false;
+	d_size += key.size() + 8;
+}
+
+void BtreeBatch::addCount( int table, const QByteArray& key, qint64 delta, const QByteArray& tail )
+{
+	Op& op = d_ops[table][key];
+	if( op.d_kind != Count )
+	{
+		op.d_kind = Count;
+		op.d_delta = 0;
+		d_size += key.size() + tail.size() + 8;
+	}
+	op.d_delta += delta;
+	if( op.d_value.isEmpty() )
+		op.d_value = tail;
+}
+
+quint64 BtreeBatch::readCount( const QByteArray& value, QByteArray* tail )
+{
+	// <count als 8 Bytes big endian> <tail>
+	if( value.size() < 8 )
+		return 0;
+	if( tail )
+		*tail = value.mid( 8 );
+	return qFromBigEndian<quint64>( (const uchar*)value.constData() );
+}
+
+static QByteArray _writeCount( quint64 n, const QByteArray& tail )
+{
+	QByteArray res( 8, 0 );
+	qToBigEndian<quint64>( n, (uchar*)res.data() );
+	return res + tail;
+}
+
+void BtreeBatch::removePrefix( int table, const QByteArray& prefix )
+{
+	d_prefixes[table].append( prefix );
+	d_size += prefix.size();
+}
+
+void BtreeBatch::clear()
+{
+	d_ops.clear();
+	d_prefixes.clear();
+	d_size = 0;
+}
+
+static bool _seek( BtreeCursor& cur, const QByteArray& key )
+{
+	// Die Keys kommen aufsteigend; liegt key knapp hinter der Position, mit moveNext
+	// vorrcken statt neu von der Wurzel abzusteigen. Die Keys vergleicht der Btree per memcmp.
+	if( cur.isValidPos() )
+	{
+		for( int s = 0; s < s_seekSteps; s++ )
+		{
+			const QByteArray k = cur.readKey();
+			if( k == key )
+				return true;
+			if( key < k )
+			{
+				if( s > 0 )
+					return false; // key liegt zwischen zwei benachbarten Eintrgen
+				break; // key liegt vor der Position
+			}
+			if( !cur.moveNext() )
+				break;
+		}
+	}
+	return cur.moveTo( key );
+}
+
+void BtreeBatch::apply( BtreeStore* db, bool append )
+{
+	QList<int> tables = ( d_ops.keys() + d_prefixes.keys() ).toSet().toList();
+	qSort( tables );
+	BtreeStore::Txn txn( db );
+	for( int t = 0; t < tables.size(); t++ )
+	{
+		BtreeCursor cur;
+		cur.open( db, tables[t], true );
+		const QList<QByteArray> prefixes = d_prefixes.value( tables[t] );
+		for( int i = 0; i < prefixes.size(); i++ )
+		{
+			if( cur.moveTo( prefixes[i], true ) ) do
+			{
+				cur.remove();
+			}while( cur.moveNext() && cur.readKey().startsWith( prefixes[i] ) );
+		}
+		const Ops& ops = d_ops[tables[t]];
+		Ops::const_iterator i;
+		for( i = ops.begin(); i != ops.end(); ++i )
+		{
+			switch( i.value().d_kind )
+			{
+			case Insert:
+				cur.insert( i.key(), i.value().d_value, append );
+				break;
+			case Remove:
+				if( _seek( cur, i.key() ) )
+					cur.remove();
+				break;
+			case RemoveIf:
+				if( _seek( cur, i.key() ) && cur.readValue().startsWith( i.value().d_value ) )
+					cur.remove();
+				break;
+			case Members:
+				{
+					const bool found = _seek( cur, i.key() );
+					QList<OID> set;
+					if( found )
+						OidSet::decode( cur.readValue(), set );
+					QMap<OID,bool>::const_iterator j;
+					for( j = i.value().d_members.begin(); j != i.value().d_members.end(); ++j )
+					{
+						if( j.value() )
+							OidSet::insert( set, j.key() );
+						else
+							OidSet::remove( set, j.key() );
+					}
+					if( !set.isEmpty() )
+						cur.insert( i.key(), OidSet::encode( set ), append && !found );
+					else if( found )
+						cur.remove();
+				}
+				break;
+			case Count:
+				{
+					const bool found = _seek( cur, i.key() );
+					QByteArray tail = i.value().d_value;
+					const qint64 n = ( found )?readCount( cur.readValue(), &tail ):0;
+					if( n + i.value().d_delta > 0 )
+						cur.insert( i.key(), _writeCount( n + i.value().d_delta, tail ), 
+							append && !found );
+					else if( found )
+						cur.remove();
+				}
+				break;
+			}
+		}
+	}
+	clear();
+}
@@ -0,0 +1,79 @@
+#ifndef __Sdb_BtreeBatch__
+#define __Sdb_BtreeBatch__
+
+/*
+* Copyright 2005-2017 Rochus Keller <mailto:me@rochus-keller.info>
+*
+* This file is part of the DoorScope Sdb library.
+*
+* The following is the license that applies to this copy of the
+* library. For a license to use the library under conditions
+* other than those described here, please email to me@rochus-keller.info.
+*
+* GNU General Public License Usage
+* This file may be used under the terms of the GNU General Public
+* License (GPL) versions 2.0 or 3.0 as published by the Free Software
+* Foundation and appearing in the file LICENSE.GPL included in
+* the packaging of this file. Please review the following information
+* to ensure GNU General Public Licensing requirements will be met:
+* http://www.fsf.org/licensing/licenses/info/GPLv2.html and
+* http://www.gnu.org/copyleft/gpl.html.
+*/
+
+#include <QMap>
+#include <QList>
+#include <QByteArray>
+#include <Sdb/Globals.h>
+
+namespace Sdb
+{
+	class BtreeStore;
+
+	// Interne Klasse
+	// Sammelt Schreiboperationen auf mehrere Tables und fhrt sie pro Table in aufsteigender
+	// Reihenfolge der Keys mit einem einzigen Cursor aus. Nahe Keys werden zum Lesen und
+	// Lschen mit moveNext erreicht statt mit einem neuen Abstieg; insert steigt weiterhin
+	// selber ab, bei neuen Records mit dem append-Hinweis. Pro Key gilt nur die letzte Operation, wobei ein insert nie durch
+	// ein remove berschrieben wird, da remove immer einen alten Zustand beschreibt.
+
+	class BtreeBatch
+	{
+	public:
+		BtreeBatch();
+
+		void insert( int table, const QByteArray& key, const QByteArray& value );
+		void remove( int table, const QByteArray& key );
+		void removeIf( int table, const QByteArray& key, const QByteArray& value ); // nur wenn Wert mit value beginnt
+		void removePrefix( int table, const QByteArray& prefix ); // vor allen brigen Ops
+		// ndert die im Wert von key gespeicherte Oid-Menge (siehe OidSet); leere Mengen
+		// werden entfernt
+		void addMember( int table, const QByteArray& key, OID );
+		void removeMember( int table, const QByteArray& key, OID );
+		// Addiert delta zum Zhler im Wert von key; ein neuer Zhler erhlt tail als Anhang,
+		// Zhler <= 0 werden entfernt
+		void addCount( int table, const QByteArray& key, qint64 delta, const QByteArray& tail );
+		static quint64 readCount( const QByteArray& value, QByteArray* tail = 0 );
+
+		// append=true..Keys werden meist am Ende des Tables eingefgt (neue Records)
+		void apply( BtreeStore*, bool append = false );
+		void clear();
+		bool isEmpty() const { return d_ops.isEmpty() && d_prefixes.isEmpty(); }
+		quint32 getSize() const { return d_size; } // ungefhr belegte Bytes
+	private:
+		enum Kind { Insert, Remove, RemoveIf, Members, Count };
+		struct Op
+		{
+			quint8 d_kind;
+			QByteArray d_value;
+			QMap<OID,bool> d_members; // true..add, false..remove
+			qint64 d_delta;
+			Op( quint8 k = Insert ):d_kind(k),d_delta(0) {}
+		};
+		typedef QMap<QByteArray,Op> Ops;
+		QMap<int,Ops> d_ops;
+		QMap<int,QList<QByteArray> > d_prefixes;
+		quint32 d_size;
+	};
+}
+
+#endif
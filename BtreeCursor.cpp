@@ -60,14 +60,14 @@ void BtreeCursor::checkOpen() const
 		throw DatabaseException( DatabaseException::AccessCursor, "cursor not open" );
 }
 
-void BtreeCursor::insert( const QByteArray& key, const QByteArray& value )
+void BtreeCursor::insert( const QByteArray& key, const QByteArray& value, bool append )
 {
 	checkOpen();
 	BtreeStore::Txn lock( d_db );
 	if( key.isEmpty() )
 		qWarning( "BtreeCursor::insert funktioniert nicht richtig mit leeren Keys" );
 	int res = sqlite3BtreeInsert( d_cur, key.data(), key.size(), 
-		value.data(), value.size(), 0, 0 );
+		value.data(), value.size(), 0, (append)?1:0 );
 	if( res != SQLITE_OK )
 	{
 		lock.rollback();
@@ -35,7 +35,8 @@ namespace Sdb
 		// das Ende hinaus, bzw. !isValidPos.
 
 		// Read/Write
-		void insert( const QByteArray& key, const QByteArray& value ); // Unabhngig von Pos
+		// Unabhngig von Pos. append=true..Hinweis an Btree, dass key meist am Ende liegt
+		void insert( const QByteArray& key, const QByteArray& value, bool append = false );
 		QByteArray readKey() const; // Pos
 		QByteArray readValue() const; // Pos
 		void remove(); // Pos
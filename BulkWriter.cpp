@@ -0,0 +1,265 @@
+/*
+* Copyright 2005-2017 Rochus Keller <mailto:me@rochus-keller.info>
+*
+* This file is part of the DoorScope Sdb library.
+*
+* The following is the license that applies to this copy of the
+* library. For a license to use the library under conditions
+* other than those described here, please email to me@rochus-keller.info.
+*
+* GNU General Public License Usage
+* This file may be used under the terms of the GNU General Public
+* License (GPL) versions 2.0 or 3.0 as published by the Free Software
+* Foundation and appearing in the file LICENSE.GPL included in
+* the packaging of this file. Please review the following information
+* to ensure GNU General Public Licensing requirements will be met:
+* http://www.fsf.org/licensing/licenses/info/GPLv2.html and
+* http://www.gnu.org/copyleft/gpl.html.
+*/
+
+#include "BulkWriter.h"
+#include "Database.h"
+#include "BtreeBatch.h"
+#include "RecordImp.h"
+#include "Exceptions.h"
+#include "IndexEngine.h"
+#include "ElemList.h"
+#include <Stream/DataWriter.h>
+#include <cassert>
+using namespace Sdb;
+using namespace Stream;
+
+static const quint32 s_oidBlock = 1024;
+
+BulkWriter::BulkWriter( Database* db ):d_db(db),d_next(0),d_end(0)
+{
+	assert( db != 0 );
+}
+
+BulkWriter::~BulkWriter()
+{
+}
+
+OID BulkWriter::allocId()
+{
+	if( d_next == d_end )
+	{
+		Database::Lock lock( d_db, true );
+		d_next = d_db->getNextOid( true, s_oidBlock );
+		d_end = d_next + s_oidBlock;
+	}
+	return d_next++;
+}
+
+BulkWriter::Rec& BulkWriter::get( OID id, Record::Type t )
+{
+	QMap<OID,Rec>::iterator i = d_recs.find( id );
+	if( i == d_recs.end() )
+		throw DatabaseException( DatabaseException::WrongContext, "record not created by BulkWriter" );
+	if( t != Record::TypeUndefined && i.value().d_type != t )
+		throw DatabaseException( DatabaseException::WrongType );
+	return i.value();
+}
+
+OID BulkWriter::createObject( Atom type, const QUuid& uuid )
+{
+	if( type && type >= Record::MinReservedField )
+		throw DatabaseException(DatabaseException::ReservedName );
+	const OID id = allocId();
+	Rec& r = d_recs.insert( id, Rec( Record::TypeObject ) ).value();
+	if( type )
+		r.d_fields[Record::FieldType].setAtom( type );
+	if( !uuid.isNull() )
+		r.d_fields[Record::FieldUuid].setUuid( uuid );
+	return id;
+}
+
+void BulkWriter::setValue( OID id, Atom name, const Stream::DataCell& v )
+{
+	if( name >= Record::MinReservedField )
+		throw DatabaseException(DatabaseException::ReservedName );
+	get( id, Record::TypeUndefined ).d_fields[name] = v;
+}
+
+OID BulkWriter::appendElem( OID obj, const Stream::DataCell& v )
+{
+	Rec& list = get( obj, Record::TypeObject ); // QMap-Knoten bleiben beim Einfgen gltig
+	const OID id = allocId();
+	Rec& elem = d_recs.insert( id, Rec( Record::TypeElement ) ).value();
+	elem.d_fields[Record::FieldValue] = v;
+	elem.d_fields[Record::FieldList].setOid( obj );
+	const OID last = list.d_fields.value( Record::FieldLastElm ).toId64();
+	if( last == 0 )
+		list.d_fields[Record::FieldFirstElm].setId64( id );
+	else
+	{
+		get( last, Record::TypeElement ).d_fields[Record::FieldNextElem].setId64( id );
+		elem.d_fields[Record::FieldPrevElem].setId64( last );
+	}
+	list.d_fields[Record::FieldLastElm].setId64( id );
+	return id;
+}
+
+OID BulkWriter::relateTo( OID source, OID target, Atom type )
+{
+	if( type && type >= Record::MinReservedField )
+		throw DatabaseException(DatabaseException::ReservedName );
+	get( source, Record::TypeObject );
+	get( target, Record::TypeObject );
+	const OID rid = allocId();
+	d_recs.insert( rid, Rec( Record::TypeRelation ) );
+	Record::Fields& rel = d_recs[rid].d_fields;
+	if( type )
+		rel[Record::FieldType].setAtom( type );
+	rel[Record::FieldSource].setOid( source );
+	rel[Record::FieldTarget].setOid( target );
+	// Wie Rel::appendTo; reflexive Relationen nur in der Source-Liste
+	for( int side = 0; side < ( (source == target)?1:2 ); side++ )
+	{
+		const OID oid = (side == 0)?source:target;
+		Record::Fields& obj = d_recs[oid].d_fields;
+		const OID last = obj.value( Record::FieldLastRel ).toId64();
+		if( last == 0 )
+			obj[Record::FieldFirstRel].setRid( rid );
+		else
+		{
+			Record::Fields& l = get( last, Record::TypeRelation ).d_fields;
+			l[( l.value( Record::FieldSource ).toId64() == oid )?Record::FieldNextSource:
+				Record::FieldNextTarget].setRid( rid );
+			d_recs[rid].d_fields[(side == 0)?Record::FieldPrevSource:
+				Record::FieldPrevTarget].setRid( last );
+		}
+		obj[Record::FieldLastRel].setRid( rid );
+	}
+	return rid;
+}
+
+void BulkWriter::aggregateTo( OID id, OID owner )
+{
+	Record::Fields& obj = get( id, Record::TypeObject ).d_fields;
+	if( obj.value( Record::FieldOwner ).toId64() != 0 )
+		throw DatabaseException( DatabaseException::WrongContext, "already aggregated" );
+	Record::Fields& o = get( owner, Record::TypeObject ).d_fields;
+	obj[Record::FieldOwner].setOid( owner );
+	const OID last = o.value( Record::FieldLastObj ).toId64();
+	if( last == 0 )
+		o[Record::FieldFirstObj].setOid( id );
+	else
+	{
+		get( last, Record::TypeObject ).d_fields[Record::FieldNextObj].setOid( id );
+		d_recs[id].d_fields[Record::FieldPrevObj].setOid( last );
+	}
+	d_recs[owner].d_fields[Record::FieldLastObj].setOid( id );
+}
+
+quint32 BulkWriter::appendSlot( OID obj, const Stream::DataCell& v )
+{
+	get( obj, Record::TypeUndefined );
+	const quint32 nr = ++d_queueNr[obj];
+	d_queue[DataCell().setId64( obj ).writeCell() + DataCell().setId32( nr ).writeCell()] = v;
+	return nr;
+}
+
+void BulkWriter::setCell( OID obj, const KeyList& key, const Stream::DataCell& v )
+{
+	get( obj, Record::TypeUndefined );
+	DataWriter _key;
+	for( int i = 0; i < key.size(); i++ )
+		_key.writeSlot( key[i] );
+	d_map[DataCell().setOid( obj ).writeCell() + _key.getStream()] = v;
+}
+
+void BulkWriter::indexElems( OID obj )
+{
+	get( obj, Record::TypeObject );
+	d_indexed.insert( obj );
+}
+
+void BulkWriter::clear()
+{
+	d_recs.clear();
+	d_queueNr.clear();
+	d_indexed.clear();
+	d_queue.clear();
+	d_map.clear();
+}
+
+void BulkWriter::rollback()
+{
+	// Die reservierten Oids bleiben verbraucht
+	clear();
+}
+
+void BulkWriter::writeElemIndex( BtreeBatch& batch )
+{
+	// Wie ElemList::build(), alle Elementelisten sind in diesem BulkWriter neu entstanden
+	const int lstTable = d_db->getLstTable();
+	foreach( OID obj, d_indexed )
+	{
+		OID id = d_recs[obj].d_fields.value( Record::FieldFirstElm ).toId64();
+		ElemList::Dir dir;
+		ElemList::Chunk c;
+		while( id != 0 )
+		{
+			if( c.size() == ElemList::ChunkSize )
+			{
+				batch.insert( lstTable, ElemList::makeKey( obj, dir.d_next ), ElemList::writeChunk( c ) );
+				dir.d_entries.append( ElemList::Entry( dir.d_next++, dir.getCount() + c.size() ) );
+				c.clear();
+			}
+			c.append( id );
+			Record::Fields& elem = d_recs[id].d_fields;
+			elem[Record::FieldChunk].setUInt32( dir.d_next );
+			id = elem.value( Record::FieldNextElem ).toId64();
+		}
+		if( !c.isEmpty() )
+		{
+			batch.insert( lstTable, ElemList::makeKey( obj, dir.d_next ), ElemList::writeChunk( c ) );
+			dir.d_entries.append( ElemList::Entry( dir.d_next++, dir.getCount() + c.size() ) );
+		}
+		batch.insert( lstTable, ElemList::makeKey( obj, 0 ), ElemList::writeDir( dir ) );
+	}
+}
+
+void BulkWriter::commit()
+{
+	if( d_recs.isEmpty() )
+		return;
+	Database::Lock lock( d_db, true );
+	BtreeBatch batch;
+	IndexEngine idx( d_db );
+	writeElemIndex( batch );
+
+	// Records, Uuids und Indizes; der Batch sortiert alles nach Table und Key
+	QMap<OID,Rec>::const_iterator i;
+	for( i = d_recs.begin(); i != d_recs.end(); ++i )
+	{
+		RecordImp imp( d_db, i.key(), (Record::Type)i.value().d_type );
+		imp.d_fields = i.value().d_fields;
+		d_db->writeRecord( &imp, 0, batch );
+		idx.update( i.key(), i.value().d_type, Record::Fields(), i.value().d_fields, batch );
+	}
+
+	// Queues und Maps
+	if( !d_queue.isEmpty() )
+	{
+		const int queTable = d_db->getQueTable();
+		QHash<OID,quint32>::const_iterator j;
+		for( j = d_queueNr.begin(); j != d_queueNr.end(); ++j )
+			batch.insert( queTable, DataCell().setId64( j.key() ).writeCell(), 
+				DataCell().setId32( j.value() ).writeCell() );
+		QMap<QByteArray,Stream::DataCell>::const_iterator k;
+		for( k = d_queue.begin(); k != d_queue.end(); ++k )
+			batch.insert( queTable, k.key(), k.value().writeCell( false, true ) ); // RISK: compression
+	}
+	if( !d_map.isEmpty() )
+	{
+		const int mapTable = d_db->getMapTable();
+		QMap<QByteArray,Stream::DataCell>::const_iterator k;
+		for( k = d_map.begin(); k != d_map.end(); ++k )
+			batch.insert( mapTable, k.key(), k.value().writeCell( false, true ) ); // RISK: compression
+	}
+	batch.apply( d_db->getStore(), true );
+	d_db->checkBlooms();
+	clear();
+}
@@ -0,0 +1,87 @@
+#ifndef __Sdb_BulkWriter__
+#define __Sdb_BulkWriter__
+
+/*
+* Copyright 2005-2017 Rochus Keller <mailto:me@rochus-keller.info>
+*
+* This file is part of the DoorScope Sdb library.
+*
+* The following is the license that applies to this copy of the
+* library. For a license to use the library under conditions
+* other than those described here, please email to me@rochus-keller.info.
+*
+* GNU General Public License Usage
+* This file may be used under the terms of the GNU General Public
+* License (GPL) versions 2.0 or 3.0 as published by the Free Software
+* Foundation and appearing in the file LICENSE.GPL included in
+* the packaging of this file. Please review the following information
+* to ensure GNU General Public Licensing requirements will be met:
+* http://www.fsf.org/licensing/licenses/info/GPLv2.html and
+* http://www.gnu.org/copyleft/gpl.html.
+*/
+
+#include <QHash>
+#include <QSet>
+#include <QMap>
+#include <QUuid>
+#include <Sdb/Record.h>
+#include <Sdb/Globals.h>
+
+namespace Sdb
+{
+	class Database;
+	class BtreeBatch;
+
+	// Erzeugt grosse Mengen neuer Objekte, Elemente und Relationen ohne Transaction und
+	// RecordCow. Die Records werden im Speicher aufgebaut und bei commit() pro Table sortiert
+	// in einer einzigen Btree-Transaktion geschrieben, zusammen mit den Index-Eintrgen.
+	// Ausgenommen sind die Oid-Blcke: allocId() reserviert sie sofort in einer eigenen
+	// Transaktion, damit die Oids schon vor commit() feststehen; rollback() gibt sie nicht frei.
+	// Es knnen nur Records miteinander verknpft werden, die im selben BulkWriter seit dem
+	// letzten commit() erzeugt wurden. Es werden keine UpdateInfo verschickt.
+	class BulkWriter
+	{
+	public:
+		typedef QList<Stream::DataCell> KeyList;
+
+		BulkWriter( Database* );
+		~BulkWriter();
+
+		OID createObject( Atom type = 0, const QUuid& = QUuid() );
+		void setValue( OID, Atom name, const Stream::DataCell& );
+		OID appendElem( OID obj, const Stream::DataCell& ); // gibt Bookmark zurck
+		OID relateTo( OID source, OID target, Atom type = 0 ); // gibt Rid zurck, append
+		void aggregateTo( OID obj, OID owner ); // append
+		quint32 appendSlot( OID obj, const Stream::DataCell& );
+		void setCell( OID obj, const KeyList& key, const Stream::DataCell& value );
+		void indexElems( OID obj ); // Positionsindex der Liste beim commit() mitschreiben, siehe Obj::indexElems
+
+		void commit();
+		void rollback(); // verwirft alles seit dem letzten commit()
+		int getCount() const { return d_recs.size(); }
+
+		Database* getDb() const { return d_db; }
+	private:
+		struct Rec
+		{
+			quint8 d_type;
+			Record::Fields d_fields;
+			Rec( quint8 t = Record::TypeUndefined ):d_type(t) {}
+		};
+		OID allocId();
+		Rec& get( OID, Record::Type );
+		void clear();
+		void writeElemIndex( BtreeBatch& );
+
+		Database* d_db;
+		QMap<OID,Rec> d_recs;
+		QHash<OID,quint32> d_queueNr;
+		QSet<OID> d_indexed; // Listen mit Positionsindex
+		QMap<QByteArray,Stream::DataCell> d_queue; // <oid> <nr> -> <cell>
+		QMap<QByteArray,Stream::DataCell> d_map; // <oid> [ <cell> ]* -> <cell>
+		OID d_next; // nchste freie Oid im reservierten Block
+		OID d_end; // erste Oid nach dem reservierten Block
+	};
+}
+
+#endif
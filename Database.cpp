@@ -21,21 +21,36 @@
 #include "Database.h"
 #include "BtreeCursor.h"
 #include "BtreeStore.h"
+#include "BtreeBatch.h"
+#include "IndexEngine.h"
 #include "Exceptions.h"
 #include "RecordImp.h"
 #include "Idx.h"
+#include "Oit.h"
+#include "Bloom.h"
 #include <Stream/DataCell.h>
 #include <Stream/DataReader.h>
 #include <Stream/DataWriter.h>
 #include <QBuffer>
+#include <QSet>
+#include <QtConcurrentMap>
+#include <QtEndian>
+#include <zlib.h>
 #include <QtDebug>
 #include <QFileInfo>
 #include <QDir>
 #include <cassert>
+#include <cstring>
 using namespace Sdb;
 using namespace Stream;
 
 static const char* s_streams = ".streams";
+static const quint32 s_valueLimit = 1024; // Bytes
+static const int s_uuidCache = 100000; // Eintrge im Cache von derefUuid
+static const int s_seqSteps = 16; // loadRecords: so viele moveNext vor einem neuen moveTo
+static const int s_dictSize = 32 * 1024; // Bytes, grsstes Fenster von zlib
+static const int s_dictSample = 512; // Bytes pro Record fr das Training des Wrterbuchs
+static const quint32 s_imageLimit = 64 * 1024 * 1024; // Bytes, grsstes entpacktes Abbild
 
 Database::Lock::Lock( Database* db, bool txn ):d_db(db), d_txn(txn)
 {
@@ -50,7 +65,10 @@ void Database::Lock::rollback()
 	if( d_db )
 	{
 		if( d_txn )
+		{
 			d_db->d_db->transAbort();
+			d_db->d_uuids.clear(); // kann Zuordnungen der verworfenen nderungen enthalten
+		}
 		//d_db->d_lock.unlock();
 		d_db = 0;
 	}
@@ -75,6 +93,11 @@ Database::Lock::~Lock()
 Database::Database(QObject*p):QObject(p)//,d_lock(QMutex::Recursive)
 {
 	d_db = 0;
+	d_valueLimit = s_valueLimit;
+	d_idxAllValid = false;
+	d_uuids.setMaxCost( s_uuidCache );
+	d_rawBytes = 0;
+	d_storedBytes = 0;
 	qRegisterMetaType<Sdb::UpdateInfo>();
 	connect( this, SIGNAL(doCheckUsed( quint64 )),
 		this,SLOT(onCheckUsed( quint64 )),Qt::QueuedConnection );
@@ -102,6 +125,8 @@ void Database::open( const QString& path )
 	d_db = new BtreeStore( this );
 	d_db->open( path.toUtf8() );
 	loadMeta();
+	d_rawBytes = 0;
+	d_storedBytes = 0;
 }
 
 void Database::close()
@@ -111,6 +136,14 @@ void Database::close()
 		delete d_db;
 	d_db = 0;
 	d_meta = Meta();
+	d_idxMeta.clear();
+	d_idxAtoms.clear();
+	d_idxAll.clear();
+	d_idxAllValid = false;
+	qDeleteAll( d_blooms );
+	d_blooms.clear();
+	d_bloomDirty.clear();
+	d_uuids.clear();
 	// TODO: d_cache + Records lschen
 }
 
@@ -134,7 +167,7 @@ RecordImp* Database::getOrLoadRecord( OID id )
 	{
 		// Record existiert in Db. Lade ihn.
 		QBuffer buf;
-		buf.buffer() = cur.readValue();
+		buf.buffer() = readImage( cur.readValue() );
 		buf.open( QIODevice::ReadOnly );
 		r = new RecordImp( this, id, Record::TypeUndefined );
 		try
@@ -151,6 +184,96 @@ RecordImp* Database::getOrLoadRecord( OID id )
 	return r;
 }
 
+struct _LoadJob
+{
+	OID d_id;
+	QByteArray d_img;
+	RecordImp* d_rec;
+	Database* d_db;
+	_LoadJob( Database* db = 0, OID id = 0 ):d_id(id),d_rec(0),d_db(db) {}
+};
+
+static void _decode( _LoadJob& j )
+{
+	// Luft ev. in einem Worker-Thread; darf nicht auf den Btree zugreifen.
+	QBuffer buf;
+	buf.buffer() = j.d_db->readImage( j.d_img );
+	j.d_img.clear();
+	buf.open( QIODevice::ReadOnly );
+	j.d_rec = new RecordImp( j.d_db, j.d_id, Record::TypeUndefined );
+	try
+	{
+		j.d_rec->readFrom( &buf );
+	}catch( std::exception& )
+	{
+		delete j.d_rec;
+		j.d_rec = 0;
+	}
+}
+
+void Database::loadRecords( const QList<OID>& ids, bool parallel )
+{
+	QList<OID> todo;
+	for( int i = 0; i < ids.size(); i++ )
+		if( ids[i] != 0 && !d_cache.contains( ids[i] ) )
+			todo.append( ids[i] );
+	if( todo.isEmpty() )
+		return;
+	qSort( todo );
+	QList<_LoadJob> jobs;
+	BtreeCursor cur;
+	cur.open( d_db, getObjTable() );
+	for( int i = 0; i < todo.size(); i++ )
+	{
+		if( i > 0 && todo[i] == todo[i-1] )
+			continue;
+		const QByteArray key = DataCell().setId64( todo[i] ).writeCell();
+		// Nahe Oids ab der aktuellen Position mit moveNext erreichen statt mit einem neuen
+		// Abstieg; die Position kann nach einem erfolglosen moveTo schon auf dem Ziel sein.
+		// Die Id64-Zellen sind nicht numerisch sortiert (Lnge variiert), darum entscheidet
+		// nur ein Treffer; sonst wird gesucht.
+		bool found = false;
+		bool decided = false;
+		if( i > 0 && cur.isValidPos() )
+		{
+			for( int s = 0; s <= s_seqSteps; s++ )
+			{
+				DataCell id;
+				id.readCell( cur.readKey() );
+				if( id.getType() != DataCell::TypeId64 )
+					break; // Uuids
+				if( id.getId64() == todo[i] )
+				{
+					found = decided = true;
+					break;
+				}
+				if( id.getId64() > todo[i] || s == s_seqSteps || !cur.moveNext() )
+					break;
+			}
+		}
+		if( !decided )
+			found = cur.moveTo( key );
+		if( found )
+		{
+			jobs.append( _LoadJob( this, todo[i] ) );
+			jobs.last().d_img = cur.readValue();
+		}
+	}
+	if( parallel && jobs.size() > 1 )
+		QtConcurrent::blockingMap( jobs, _decode );
+	else
+		for( int i = 0; i < jobs.size(); i++ )
+			_decode( jobs[i] );
+	for( int i = 0; i < jobs.size(); i++ )
+	{
+		if( jobs[i].d_rec == 0 )
+			continue;
+		d_cache[jobs[i].d_id] = jobs[i].d_rec;
+		// Wird der Record bis dahin nicht verwendet, fllt er wieder aus dem Cache
+		checkUsed( jobs[i].d_id );
+	}
+}
+
 void Database::checkUsed( OID id )
 {
 	emit doCheckUsed( id );
@@ -170,26 +293,247 @@ void Database::onCheckUsed( OID id )
 	}
 }
 
-void Database::saveRecord( RecordImp* r )
+void Database::saveRecord( RecordImp* r, const Record::Fields* changed )
+{
+	BtreeBatch batch;
+	writeRecord( r, changed, batch );
+	batch.apply( d_db );
+}
+
+void Database::writeRecord( RecordImp* r, const Record::Fields* changed, BtreeBatch& batch )
 {
 	assert( r );
-	BtreeCursor cur;
-	cur.open( d_db, getObjTable(), true );
 	QBuffer buf;
 	buf.open( QIODevice::WriteOnly );
-	r->writeTo( &buf );
+	QMap<Atom,QByteArray> large;
+	r->writeTo( &buf, d_valueLimit, large );
 	buf.close();
-	cur.insert( DataCell().setId64( r->getId() ).writeCell(), buf.buffer() );
+	batch.insert( getObjTable(), DataCell().setId64( r->getId() ).writeCell(), 
+		writeImage( buf.buffer() ) );
+	saveValues( r, large, changed, batch );
+}
+
+static QByteArray _versionTag( quint8 version )
+{
+	DataWriter w;
+	w.writeSlot( DataCell().setUInt8( version ) );
+	return w.getStream();
+}
+
+// Komprimierte Abbilder beginnen mit Version 2 statt 1, gefolgt vom qCompress-Block,
+// bzw. ab Version 3 mit <Lnge 4B BE> und einem zlib-Strom mit dem Wrterbuch der Datenbank.
+// Beim Laden gebildet und nicht erst beim ersten Aufruf, da readImage auch in
+// Worker-Threads luft (IndexEngine::decode, loadRecords).
+static const QByteArray s_zipTag = _versionTag( 2 );
+static const QByteArray s_dictTag = _versionTag( 3 );
+
+static QByteArray _deflate( const QByteArray& img, const QByteArray& dict )
+{
+	z_stream s;
+	::memset( &s, 0, sizeof(s) );
+	if( ::deflateInit( &s, Z_BEST_SPEED ) != Z_OK )
+		return QByteArray();
+	if( !dict.isEmpty() && 
+		::deflateSetDictionary( &s, (const Bytef*)dict.constData(), dict.size() ) != Z_OK )
+	{
+		::deflateEnd( &s );
+		return QByteArray();
+	}
+	QByteArray out( s_dictTag.size() + 4 + ::deflateBound( &s, img.size() ), 0 );
+	::memcpy( out.data(), s_dictTag.constData(), s_dictTag.size() );
+	qToBigEndian<quint32>( img.size(), (uchar*)out.data() + s_dictTag.size() );
+	const int head = s_dictTag.size() + 4;
+	s.next_in = (Bytef*)img.constData();
+	s.avail_in = img.size();
+	s.next_out = (Bytef*)out.data() + head;
+	s.avail_out = out.size() - head;
+	const int res = ::deflate( &s, Z_FINISH );
+	out.resize( head + s.total_out );
+	::deflateEnd( &s );
+	if( res != Z_STREAM_END )
+		return QByteArray();
+	return out;
+}
+
+static QByteArray _inflate( const QByteArray& img, const QByteArray& dict )
+{
+	const int head = s_dictTag.size() + 4;
+	if( img.size() < head )
+		return QByteArray();
+	const quint32 len = qFromBigEndian<quint32>( (const uchar*)img.constData() + s_dictTag.size() );
+	if( len > s_imageLimit ) // Lnge aus dem Abbild nicht ungeprft allozieren
+		throw DatabaseException( DatabaseException::RecordFormat, "compressed record too large" );
+	QByteArray out( len, 0 );
+	z_stream s;
+	::memset( &s, 0, sizeof(s) );
+	if( ::inflateInit( &s ) != Z_OK )
+		return QByteArray();
+	s.next_in = (Bytef*)img.constData() + head;
+	s.avail_in = img.size() - head;
+	s.next_out = (Bytef*)out.data();
+	s.avail_out = len;
+	int res = ::inflate( &s, Z_FINISH );
+	if( res == Z_NEED_DICT )
+	{
+		// Prft selber anhand der Adler-Summe, ob es das Wrterbuch des Stroms ist
+		if( dict.isEmpty() || 
+			::inflateSetDictionary( &s, (const Bytef*)dict.constData(), dict.size() ) != Z_OK )
+		{
+			::inflateEnd( &s );
+			return QByteArray();
+		}
+		res = ::inflate( &s, Z_FINISH );
+	}
+	const bool ok = res == Z_STREAM_END && s.total_out == len;
+	::inflateEnd( &s );
+	if( !ok )
+		return QByteArray();
+	return out;
+}
+
+QByteArray Database::writeImage( const QByteArray& img )
+{
+	d_rawBytes += img.size();
+	if( d_meta.d_zipLimit != 0 && quint32(img.size()) >= d_meta.d_zipLimit )
+	{
+		const QByteArray zip = _deflate( img, d_meta.d_zipDict );
+		if( !zip.isEmpty() && zip.size() < img.size() )
+		{
+			d_storedBytes += zip.size();
+			return zip;
+		}
+	}
+	d_storedBytes += img.size();
+	return img;
+}
+
+QByteArray Database::readImage( const QByteArray& img ) const
+{
+	if( img.startsWith( s_zipTag ) )
+	{
+		const QByteArray res = qUncompress( img.mid( s_zipTag.size() ) );
+		if( res.isEmpty() )
+			throw DatabaseException( DatabaseException::RecordFormat, "invalid compressed record" );
+		return res;
+	}else if( img.startsWith( s_dictTag ) )
+	{
+		const QByteArray res = _inflate( img, d_meta.d_zipDict );
+		if( res.isEmpty() )
+			throw DatabaseException( DatabaseException::RecordFormat, "invalid compressed record" );
+		return res;
+	}else
+		return img;
+}
+
+void Database::setCompression( quint32 limit )
+{
+	checkOpen();
+	Lock lock( this, true );
+	d_meta.d_zipLimit = limit;
+	if( limit != 0 && d_meta.d_zipDict.isEmpty() )
+		d_meta.d_zipDict = trainDictionary();
+	saveMeta();
+}
+
+QByteArray Database::trainDictionary()
+{
+	// Wrterbuch aus dem Anfang bestehender Record-Abbilder; dieser enthlt die Atome der
+	// Felder und die Struktur, welche sich ber viele Records wiederholen. zlib gewichtet
+	// das Ende des Wrterbuchs strker, die Reihenfolge ist hier aber ohne Belang.
+	// Die Stichproben sind gleichmssig ber den Oid-Bereich verteilt, damit nicht nur die
+	// ltesten Records (und deren Typen) eingehen.
+	const OID max = getMaxOid();
+	const int samples = s_dictSize / s_dictSample;
+	const OID step = qMax( max / samples, OID(1) );
+	QByteArray dict;
+	QSet<OID> done;
+	BtreeCursor cur;
+	cur.open( d_db, getObjTable(), false );
+	for( OID oid = 1; oid < max && dict.size() < s_dictSize; oid += step )
+	{
+		// Ohne Treffer steht der Cursor auf einem benachbarten Record
+		cur.moveTo( DataCell().setId64( oid ).writeCell() );
+		if( !cur.isValidPos() )
+			continue;
+		DataCell id;
+		id.readCell( cur.readKey() );
+		if( id.getType() != DataCell::TypeId64 || done.contains( id.getId64() ) )
+			continue; // Uuids bzw. schon verwendet
+		done.insert( id.getId64() );
+		dict += readImage( cur.readValue() ).left( s_dictSample );
+	}
+	return dict.left( s_dictSize );
+}
+
+double Database::getCompressionRatio() const
+{
+	if( d_storedBytes == 0 )
+		return 1.0;
+	return double( d_rawBytes ) / double( d_storedBytes );
+}
+
+void Database::saveValues( RecordImp* r, const QMap<Atom,QByteArray>& large, 
+						  const Record::Fields* changed, BtreeBatch& batch )
+{
+	if( large.isEmpty() && r->d_ool.isEmpty() )
+		return;
+	const int table = getValTable();
+	const QByteArray oid = DataCell().setOid( r->getId() ).writeCell();
+	// Bisher ausgelagerte Werte, die geladen wurden und nun klein oder null sind, entfernen.
+	// Nicht geladene Werte wurden nicht verndert und bleiben ausgelagert.
+	QSet<Atom> ool;
+	QSet<Atom>::const_iterator i;
+	for( i = r->d_ool.begin(); i != r->d_ool.end(); ++i )
+	{
+		if( !r->d_fields.contains( *i ) )
+			ool.insert( *i );
+		else if( !large.contains( *i ) )
+			batch.remove( table, oid + DataCell().setAtom( *i ).writeCell() );
+	}
+	// Nur die genderten grossen Werte schreiben, unvernderte liegen bereits in der Tabelle.
+	QMap<Atom,QByteArray>::const_iterator j;
+	for( j = large.begin(); j != large.end(); ++j )
+	{
+		if( changed == 0 || changed->contains( j.key() ) || !r->d_ool.contains( j.key() ) )
+			batch.insert( table, oid + DataCell().setAtom( j.key() ).writeCell(), 
+				writeImage( j.value() ) );
+		ool.insert( j.key() );
+	}
+	r->d_ool = ool;
+}
+
+bool Database::loadValue( OID id, Atom a, Stream::DataCell& v )
+{
+	BtreeCursor cur;
+	cur.open( d_db, getValTable() );
+	if( cur.moveTo( DataCell().setOid( id ).writeCell() + DataCell().setAtom( a ).writeCell() ) )
+	{
+		// Unkomprimierte Werte sind Text-Cells und beginnen nie mit dem Versions-Slot
+		v.readCell( readImage( cur.readValue() ) );
+		return true;
+	}else
+	{
+		v.setNull();
+		return false;
+	}
 }
 
 void Database::eraseRecord( RecordImp* r )
+{
+	BtreeBatch batch;
+	eraseRecord( r, batch );
+	batch.apply( d_db );
+}
+
+void Database::eraseRecord( RecordImp* r, BtreeBatch& batch )
 {
 	assert( r );
-	BtreeCursor cur;
-	cur.open( d_db, getObjTable(), true );
-	const bool res = cur.moveTo( DataCell().setId64( r->getId() ).writeCell() );
-	assert( res );
-	cur.remove();
+	batch.remove( getObjTable(), DataCell().setId64( r->getId() ).writeCell() );
+	if( !r->d_ool.isEmpty() )
+	{
+		batch.removePrefix( getValTable(), DataCell().setOid( r->getId() ).writeCell() );
+		r->d_ool.clear();
+	}
 }
 
 void Database::dumpQueue( OID id )
@@ -233,7 +577,7 @@ void Database::dump()
 		{
 			RecordImp r(this, k.getId64() );
 			QBuffer buf;
-			buf.buffer() = cur.readValue();
+			buf.buffer() = readImage( cur.readValue() );
 			buf.open( QIODevice::ReadOnly );
 			r.readFrom( &buf );
 			r.dump();
@@ -283,6 +627,24 @@ void Database::loadMeta()
 					d_meta.d_queTable = value.getInt32();
 				else if( name == "mapTable" )
 					d_meta.d_mapTable = value.getInt32();
+				else if( name == "valTable" )
+					d_meta.d_valTable = value.getInt32();
+				else if( name == "typIndex" ) // "typTable" hatte Keys mit Oid-Cell
+					d_meta.d_typTable = value.getInt32();
+				else if( name == "cntTable" )
+					d_meta.d_cntTable = value.getInt32();
+				else if( name == "blmTable" )
+					d_meta.d_blmTable = value.getInt32();
+				else if( name == "lstTable" )
+					d_meta.d_lstTable = value.getInt32();
+				else if( name == "adjTable" )
+					d_meta.d_adjTable = value.getInt32();
+				else if( name == "zipLimit" )
+					d_meta.d_zipLimit = value.getUInt32();
+				else if( name == "zipDict" )
+					d_meta.d_zipDict = value.getArr();
+				else if( name == "uuidBloom" )
+					d_meta.d_uuidBloom = value.getBool();
 				// else
 					// throw DatabaseException( DatabaseException::DatabaseMeta, "invalid meta header format" );
 					// stattdessen ignorieren
@@ -305,6 +667,24 @@ void Database::saveMeta()
 	value.writeSlot( DataCell().setInt32( d_meta.d_queTable ), "queTable" );
 	if( d_meta.d_mapTable )
 		value.writeSlot( DataCell().setInt32( d_meta.d_mapTable ), "mapTable" );
+	if( d_meta.d_valTable )
+		value.writeSlot( DataCell().setInt32( d_meta.d_valTable ), "valTable" );
+	if( d_meta.d_typTable )
+		value.writeSlot( DataCell().setInt32( d_meta.d_typTable ), "typIndex" );
+	if( d_meta.d_cntTable )
+		value.writeSlot( DataCell().setInt32( d_meta.d_cntTable ), "cntTable" );
+	if( d_meta.d_blmTable )
+		value.writeSlot( DataCell().setInt32( d_meta.d_blmTable ), "blmTable" );
+	if( d_meta.d_lstTable )
+		value.writeSlot( DataCell().setInt32( d_meta.d_lstTable ), "lstTable" );
+	if( d_meta.d_adjTable )
+		value.writeSlot( DataCell().setInt32( d_meta.d_adjTable ), "adjTable" );
+	if( d_meta.d_zipLimit )
+		value.writeSlot( DataCell().setUInt32( d_meta.d_zipLimit ), "zipLimit" );
+	if( !d_meta.d_zipDict.isEmpty() )
+		value.writeSlot( DataCell().setLob( d_meta.d_zipDict ), "zipDict" );
+	if( d_meta.d_uuidBloom )
+		value.writeSlot( DataCell().setBool( true ), "uuidBloom" );
 	d_db->writeMeta( DataCell().setNull().writeCell(), value.getStream() );
 }
 
@@ -386,7 +766,390 @@ int Database::getMapTable()
 	return d_meta.d_mapTable;
 }
 
-OID Database::getNextOid(bool persist)
+int Database::getLstTable()
+{
+	checkOpen();
+	if( d_meta.d_lstTable == 0 )
+	{
+		BtreeStore::Txn txn( d_db );
+		d_meta.d_lstTable = d_db->createTable();
+		saveMeta();
+	}
+	return d_meta.d_lstTable;
+}
+
+int Database::getValTable()
+{
+	checkOpen();
+	if( d_meta.d_valTable == 0 )
+	{
+		BtreeStore::Txn txn( d_db );
+		d_meta.d_valTable = d_db->createTable();
+		saveMeta();
+	}
+	return d_meta.d_valTable;
+}
+
+int Database::buildTypTable()
+{
+	checkOpen();
+	if( d_meta.d_typTable == 0 )
+	{
+		BtreeStore::Txn txn( d_db );
+		d_meta.d_typTable = d_db->createTable( true );
+		saveMeta();
+		// Bestehende Objekte nachtragen
+		BtreeBatch batch;
+		BtreeCursor cur;
+		cur.open( d_db, getObjTable(), false );
+		if( cur.moveFirst() ) do
+		{
+			DataCell id;
+			id.readCell( cur.readKey() );
+			if( id.isNull() || id.isUuid() )
+				continue;
+			QBuffer buf;
+			buf.buffer() = readImage( cur.readValue() );
+			buf.open( QIODevice::ReadOnly );
+			RecordImp r( this, id.getId64() );
+			r.readFrom( &buf );
+			const DataCell& type = r.d_fields.value( Record::FieldType );
+			if( r.getType() == Record::TypeObject && type.getType() == DataCell::TypeAtom )
+				batch.insert( d_meta.d_typTable, typeKey( type.getAtom(), r.getId() ), QByteArray() );
+		}while( cur.moveNext() );
+		batch.apply( d_db );
+	}
+	return d_meta.d_typTable;
+}
+
+void Database::createTypeIndex()
+{
+	checkOpen();
+	Lock lock( this, true );
+	buildTypTable();
+}
+
+void Database::createRelationIndex()
+{
+	checkOpen();
+	Lock lock( this, true );
+	buildAdjTable();
+}
+
+int Database::buildAdjTable()
+{
+	checkOpen();
+	if( d_meta.d_adjTable == 0 )
+	{
+		BtreeStore::Txn txn( d_db );
+		d_meta.d_adjTable = d_db->createTable( true );
+		saveMeta();
+		// Bestehende Relationen nachtragen
+		BtreeBatch batch;
+		BtreeCursor cur;
+		cur.open( d_db, getObjTable(), false );
+		if( cur.moveFirst() ) do
+		{
+			DataCell id;
+			id.readCell( cur.readKey() );
+			if( id.isNull() || id.isUuid() )
+				continue;
+			QBuffer buf;
+			buf.buffer() = readImage( cur.readValue() );
+			buf.open( QIODevice::ReadOnly );
+			RecordImp r( this, id.getId64() );
+			r.readFrom( &buf );
+			if( r.getType() == Record::TypeRelation )
+				foreach( const QByteArray& key, IndexEngine::adjKeys( r.getId(), r.d_fields ) )
+					batch.insert( d_meta.d_adjTable, key, QByteArray() );
+		}while( cur.moveNext() );
+		batch.apply( d_db );
+	}
+	return d_meta.d_adjTable;
+}
+
+int Database::getCntTable()
+{
+	checkOpen();
+	if( d_meta.d_cntTable == 0 )
+	{
+		BtreeStore::Txn txn( d_db );
+		d_meta.d_cntTable = d_db->createTable();
+		saveMeta();
+	}
+	return d_meta.d_cntTable;
+}
+
+int Database::getBlmTable()
+{
+	checkOpen();
+	if( d_meta.d_blmTable == 0 )
+	{
+		BtreeStore::Txn txn( d_db );
+		d_meta.d_blmTable = d_db->createTable();
+		saveMeta();
+	}
+	return d_meta.d_blmTable;
+}
+
+static QByteArray _bloomKey( int table, qint64 block = -1 )
+{
+	// <table> ..Kopf mit Anzahl Blcke und Keys; <table> <block>..Block
+	QByteArray key = DataCell().setId32( table ).writeCell();
+	if( block >= 0 )
+		key += DataCell().setUInt32( block ).writeCell();
+	return key;
+}
+
+Bloom* Database::getBloom( int table )
+{
+	QHash<int,Bloom*>::const_iterator i = d_blooms.find( table );
+	if( i != d_blooms.end() )
+		return i.value();
+	bool enabled = false;
+	if( table == getObjTable() )
+		enabled = d_meta.d_uuidBloom;
+	else
+	{
+		IndexMeta meta;
+		enabled = getIndexMeta( table, meta ) && meta.d_bloom;
+	}
+	Bloom* b = 0;
+	if( enabled )
+	{
+		b = loadBloom( table );
+		if( b == 0 || b->isOverloaded() )
+		{
+			// Nur im Speicher; getBloom luft auch in derefUuid und Idx::seek
+			delete b;
+			b = buildBloom( table );
+			d_bloomDirty.insert( table );
+		}
+	}
+	d_blooms[table] = b;
+	return b;
+}
+
+Bloom* Database::loadBloom( int table )
+{
+	if( d_meta.d_blmTable == 0 )
+		return 0;
+	BtreeCursor cur;
+	cur.open( d_db, d_meta.d_blmTable, false );
+	if( !cur.moveTo( _bloomKey( table ) ) )
+		return 0;
+	DataReader r( cur.readValue() );
+	r.nextToken();
+	const quint32 blocks = r.readValue().getUInt32();
+	r.nextToken();
+	const quint64 count = r.readValue().getUInt64();
+	Bloom* b = new Bloom( blocks );
+	b->setCount( count );
+	for( quint32 i = 0; i < blocks; i++ )
+	{
+		if( !cur.moveTo( _bloomKey( table, i ) ) )
+		{
+			delete b;
+			return 0; // unvollstndig, neu aufbauen
+		}
+		b->setBlock( i, cur.readValue() );
+	}
+	return b;
+}
+
+Bloom* Database::buildBloom( int table )
+{
+	// Bei objTable die Uuids, bei Indizes die Items der Keys
+	const bool uuids = table == getObjTable();
+	IndexMeta meta;
+	if( !uuids )
+		getIndexMeta( table, meta );
+	QList<QByteArray> keys;
+	BtreeCursor cur;
+	cur.open( d_db, table, false );
+	if( cur.moveFirst() ) do
+	{
+		if( uuids )
+		{
+			DataCell k;
+			k.readCell( cur.readKey() );
+			if( k.isUuid() )
+				keys.append( cur.readKey() );
+		}else
+			keys.append( Idx::bloomKey( meta, cur.readKey(), Idx::readValue( cur.readValue() ) ) );
+	}while( cur.moveNext() );
+	// Mit Reserve fr knftige Inserts
+	Bloom* b = new Bloom( Bloom::blocksFor( keys.size() * 2 + 1024 ) );
+	for( int i = 0; i < keys.size(); i++ )
+		b->add( keys[i] );
+	return b;
+}
+
+static QByteArray _bloomHead( const Bloom* b )
+{
+	DataWriter w;
+	w.writeSlot( DataCell().setUInt32( b->getBlockCount() ) );
+	w.writeSlot( DataCell().setUInt64( b->getCount() ) );
+	return w.getStream();
+}
+
+void Database::saveBloom( int table, const Bloom* b, BtreeBatch& batch )
+{
+	const int blm = getBlmTable();
+	batch.removePrefix( blm, _bloomKey( table ) );
+	for( quint32 i = 0; i < b->getBlockCount(); i++ )
+		batch.insert( blm, _bloomKey( table, i ), b->getBlock( i ) );
+	batch.insert( blm, _bloomKey( table ), _bloomHead( b ) );
+}
+
+void Database::storeBloom( int table )
+{
+	delete d_blooms.take( table );
+	Bloom* b = buildBloom( table );
+	BtreeBatch batch;
+	saveBloom( table, b, batch );
+	batch.apply( d_db );
+	d_blooms[table] = b;
+	d_bloomDirty.remove( table );
+}
+
+void Database::addToBloom( int table, const QByteArray& key, BtreeBatch& batch )
+{
+	Bloom* b = getBloom( table );
+	if( b == 0 )
+		return;
+	const quint32 block = b->add( key );
+	if( d_bloomDirty.contains( table ) )
+	{
+		// Der gespeicherte Filter fehlt oder ist berladen; ganz ersetzen
+		saveBloom( table, b, batch );
+		d_bloomDirty.remove( table );
+		return;
+	}
+	const int blm = getBlmTable();
+	batch.insert( blm, _bloomKey( table, block ), b->getBlock( block ) );
+	batch.insert( blm, _bloomKey( table ), _bloomHead( b ) );
+}
+
+void Database::checkBlooms()
+{
+	// Ein berladener Filter wird erst hier verworfen, wenn alle Keys im Table stehen;
+	// der nchste getBloom baut ihn im Speicher mit Reserve neu auf.
+	QHash<int,Bloom*>::iterator i = d_blooms.begin();
+	while( i != d_blooms.end() )
+	{
+		if( i.value() != 0 && i.value()->isOverloaded() )
+		{
+			delete i.value();
+			i = d_blooms.erase( i );
+		}else
+			++i;
+	}
+}
+
+void Database::createUuidFilter()
+{
+	checkOpen();
+	Lock lock( this, true );
+	if( d_meta.d_uuidBloom )
+		return;
+	d_meta.d_uuidBloom = true;
+	saveMeta();
+	storeBloom( getObjTable() );
+}
+
+QByteArray Database::typeKey( Atom type, OID id )
+{
+	// Oid als 8 Bytes BE, da die Multibyte-Kodierung der Cells nicht nach Wert sortiert
+	QByteArray key = DataCell().setAtom( type ).writeCell();
+	const int off = key.size();
+	key.resize( off + 8 );
+	qToBigEndian<quint64>( id, (uchar*)key.data() + off );
+	return key;
+}
+
+QByteArray Database::adjKey( OID obj, quint8 side, Atom type, OID rid )
+{
+	QByteArray key = DataCell().setOid( obj ).writeCell() + DataCell().setUInt8( side ).writeCell() + 
+		DataCell().setAtom( type ).writeCell();
+	if( rid )
+		key += DataCell().setRid( rid ).writeCell();
+	return key;
+}
+
+QList<OID> Database::findRelations( OID obj, Atom type, quint8 sides, quint32 max )
+{
+	checkOpen();
+	if( d_meta.d_adjTable == 0 )
+		throw DatabaseException( DatabaseException::AccessDatabase, "no relation index" );
+	QList<OID> res;
+	QSet<OID> found;
+	BtreeCursor cur;
+	cur.open( d_db, d_meta.d_adjTable );
+	for( quint8 side = SourceSide; side <= TargetSide; side <<= 1 )
+	{
+		if( ( sides & side ) == 0 )
+			continue;
+		const QByteArray prefix = adjKey( obj, side, type );
+		if( cur.moveTo( prefix, true ) ) do
+		{
+			const QByteArray key = cur.readKey();
+			if( !key.startsWith( prefix ) )
+				break;
+			DataCell rid;
+			rid.readCell( key.mid( prefix.size() ) );
+			// Reflexive Relationen stehen auf beiden Seiten
+			if( found.contains( rid.getRid() ) )
+				continue;
+			found.insert( rid.getRid() );
+			res.append( rid.getRid() );
+			if( quint32(res.size()) >= max )
+				return res;
+		}while( cur.moveNext() );
+	}
+	return res;
+}
+
+quint32 Database::countRelations( OID obj, Atom type, quint8 sides )
+{
+	checkOpen();
+	if( d_meta.d_adjTable == 0 )
+		throw DatabaseException( DatabaseException::AccessDatabase, "no relation index" );
+	// Beide Seiten sind nach der Rid-Zelle sortiert; reflexive Relationen stehen auf beiden
+	// Seiten und werden beim gleichzeitigen Abschreiten nur einmal gezhlt.
+	const QByteArray sp = adjKey( obj, SourceSide, type );
+	const QByteArray tp = adjKey( obj, TargetSide, type );
+	BtreeCursor s;
+	s.open( d_db, d_meta.d_adjTable );
+	BtreeCursor t;
+	t.open( d_db, d_meta.d_adjTable );
+	bool hasS = ( sides & SourceSide ) && s.moveTo( sp, true );
+	bool hasT = ( sides & TargetSide ) && t.moveTo( tp, true );
+	quint32 n = 0;
+	while( hasS || hasT )
+	{
+		const QByteArray rs = ( hasS )?s.readKey().mid( sp.size() ):QByteArray();
+		const QByteArray rt = ( hasT )?t.readKey().mid( tp.size() ):QByteArray();
+		const bool stepS = hasS && ( !hasT || rs <= rt );
+		const bool stepT = hasT && ( !hasS || rt <= rs );
+		n++;
+		if( stepS )
+			hasS = s.moveNext() && s.readKey().startsWith( sp );
+		if( stepT )
+			hasT = t.moveNext() && t.readKey().startsWith( tp );
+	}
+	return n;
+}
+
+Oit Database::objectsOfType( Atom type )
+{
+	checkOpen();
+	if( d_meta.d_typTable == 0 )
+		throw DatabaseException( DatabaseException::AccessDatabase, "no type index" );
+	return Oit( this, type );
+}
+
+OID Database::getNextOid(bool persist, quint32 count)
 {
 	checkOpen();
 	OID id = 0;
@@ -401,8 +1164,9 @@ OID Database::getNextOid(bool persist)
 		id = v.toId64();
 	}
 	id++;
-	if( persist )
-		cur.insert( DataCell().setNull().writeCell(), DataCell().setUInt64( id ).writeCell() );
+	if( persist && count > 0 )
+		cur.insert( DataCell().setNull().writeCell(), 
+			DataCell().setUInt64( id + count - 1 ).writeCell() );
 	return id;
 }
 
@@ -732,8 +1496,20 @@ static QByteArray writeIndexMeta( const IndexMeta& m )
 		w.writeSlot( DataCell().setBool( m.d_items[i].d_nocase ), NameTag("nc") );
 		w.writeSlot( DataCell().setBool( m.d_items[i].d_invert ), NameTag("inv") );
 		w.writeSlot( DataCell().setUInt8( m.d_items[i].d_coll ), NameTag("coll") );
+		if( m.d_items[i].d_ordered )
+			w.writeSlot( DataCell().setBool( true ), NameTag("ord") );
 		w.endFrame();
 	}
+	for( int i = 0; i < m.d_include.size(); i++ )
+		w.writeSlot( DataCell().setAtom( m.d_include[i] ), NameTag("inc") );
+	if( m.d_counted )
+		w.writeSlot( DataCell().setBool( true ), NameTag("cnt") );
+	if( m.d_bloom )
+		w.writeSlot( DataCell().setBool( true ), NameTag("bloom") );
+	for( int i = 0; i < m.d_types.size(); i++ )
+		w.writeSlot( DataCell().setAtom( m.d_types[i] ), NameTag("typ") );
+	for( int i = 0; i < m.d_required.size(); i++ )
+		w.writeSlot( DataCell().setAtom( m.d_required[i] ), NameTag("req") );
 	return w.getStream();
 }
 
@@ -761,8 +1537,20 @@ static void readIndexMeta( const QByteArray& data, IndexMeta& m )
 					item.d_invert = value.getBool();
 				else if( name == "coll" )
 					item.d_coll = value.getUInt8();
+				else if( name == "ord" )
+					item.d_ordered = value.getBool();
 				else if( name == "kind" )
 					m.d_kind = (IndexMeta::Kind)value.getUInt8();
+				else if( name == "inc" )
+					m.d_include.append( value.getAtom() );
+				else if( name == "cnt" )
+					m.d_counted = value.getBool();
+				else if( name == "bloom" )
+					m.d_bloom = value.getBool();
+				else if( name == "typ" )
+					m.d_types.append( value.getAtom() );
+				else if( name == "req" )
+					m.d_required.append( value.getAtom() );
 			}
 			break;
 		case DataReader::BeginFrame:
@@ -788,7 +1576,7 @@ error:
 		"invalid index meta format" );
 }
 
-quint32 Database::createIndex( const QByteArray& name, const IndexMeta& meta )
+quint32 Database::createIndex( const QByteArray& name, const IndexMeta& meta, Progress* p )
 {
 	checkOpen();
 	Lock lock( this, true );
@@ -796,7 +1584,14 @@ quint32 Database::createIndex( const QByteArray& name, const IndexMeta& meta )
 		throw DatabaseException( DatabaseException::IndexExists );
 
 	assert( !meta.d_items.isEmpty() );
+	assert( !meta.d_counted || meta.d_kind == IndexMeta::Value );
 	const quint32 table = d_db->createTable();
+	// Bestehende Records indizieren, bevor der Index registriert wird
+	if( !IndexEngine::build( this, table, meta, p ) )
+	{
+		d_db->dropTable( table );
+		return 0;
+	}
 	BtreeCursor cur;
 	cur.open( d_db, getIdxTable(), true );
 	const QByteArray id = DataCell().setId32( table ).writeCell();
@@ -807,6 +1602,10 @@ quint32 Database::createIndex( const QByteArray& name, const IndexMeta& meta )
 	// bzw. wenn der Wert eines Elements Null ist, wird der Eintrag nicht gemacht.
 	cur.insert( DataCell().setAtom( meta.d_items[0].d_atom ).writeCell() + id, id );
 	d_idxMeta[table] = meta;
+	d_idxAtoms.remove( meta.d_items[0].d_atom );
+	d_idxAllValid = false;
+	if( meta.d_bloom )
+		storeBloom( table );
 	return table;
 }
 
@@ -853,31 +1652,71 @@ QList<quint32> Database::findIndexForAtom( quint32 atom )
 	return idx;
 }
 
-OID Database::derefUuid( const QUuid& uuid )
+QList<quint32> Database::getIndexes()
 {
+	checkOpen();
+	Lock lock( this, false );
+	if( d_idxAllValid )
+		return d_idxAll;
+	d_idxAll.clear();
 	BtreeCursor cur;
-	cur.open( d_db, getObjTable(), false );
-	if( cur.moveTo( DataCell().setUuid( uuid ).writeCell() ) )
+	cur.open( d_db, getIdxTable(), false );
+	// Der Table enthlt Name -> ID, ID -> Meta und Atom ID -> ID. Nur ID -> Meta ist 
+	// ein einzelnes Id32 als Key.
+	if( cur.moveFirst() ) do
 	{
+		const QByteArray key = cur.readKey();
 		DataCell id;
-		id.readCell( cur.readValue() );
-		return id.getId64();
-	}else
-		return 0;
+		id.readCell( key );
+		if( id.getType() == DataCell::TypeId32 && id.writeCell() == key )
+			d_idxAll.append( id.getId32() );
+	}while( cur.moveNext() );
+	d_idxAllValid = true;
+	return d_idxAll;
+}
+
+OID Database::derefUuid( const QUuid& uuid )
+{
+	const QByteArray key = DataCell().setUuid( uuid ).writeCell();
+	if( const OID* id = d_uuids.object( key ) )
+		return *id;
+	OID res = 0;
+	Bloom* b = getBloom( getObjTable() );
+	if( b == 0 || b->mayContain( key ) )
+	{
+		BtreeCursor cur;
+		cur.open( d_db, getObjTable(), false );
+		if( cur.moveTo( key ) )
+		{
+			DataCell id;
+			id.readCell( cur.readValue() );
+			res = id.getId64();
+		}
+	}
+	d_uuids.insert( key, new OID( res ) );
+	return res;
 }
 
 void Database::setUuid( OID orl, const QUuid& uuid )
 {
-	BtreeStore::Txn txn( d_db );
-	BtreeCursor cur;
-	cur.open( d_db, getObjTable(), true );
+	BtreeBatch batch;
+	setUuid( orl, uuid, batch );
+	batch.apply( d_db );
+	checkBlooms();
+}
+
+void Database::setUuid( OID orl, const QUuid& uuid, BtreeBatch& batch )
+{
+	const QByteArray key = DataCell().setUuid( uuid ).writeCell();
+	// Erst nach dem Schreiben wieder in den Cache; so bleibt er auch bei Fehlern gltig
+	d_uuids.remove( key );
 	if( orl == 0 )
+		batch.remove( getObjTable(), key );
+	else
 	{
-		if( cur.moveTo( DataCell().setUuid( uuid ).writeCell() ) )
-			cur.remove();
-	}else
-		cur.insert( DataCell().setUuid( uuid ).writeCell(), 
-			DataCell().setId64( orl ).writeCell() );
+		batch.insert( getObjTable(), key, DataCell().setId64( orl ).writeCell() );
+		addToBloom( getObjTable(), key, batch );
+	}
 }
 
 RecordImp* Database::createRecord( Record::Type type )
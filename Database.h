@@ -4,14 +4,21 @@
 #include <QObject>
 #include <QMutex>
 #include <QHash>
+#include <QCache>
+#include <QSet>
 #include <Sdb/Globals.h>
 #include <Sdb/Record.h>
 #include <Sdb/UpdateInfo.h>
 
+class SdbTests;
+
 namespace Sdb
 {
 	class BtreeStore;
+	class BtreeBatch;
 	class RecordImp;
+	class Oit;
+	class Bloom;
 
 	// Hauptklasse fr den Client-Zugriff.
 	// Versteckt Btree. Wird von mehreren Threads parallel gebraucht.
@@ -31,6 +38,13 @@ namespace Sdb
 			Database* d_db;
 			bool d_txn; // Starte zudem DB-Transaktion
 		};
+		class Progress
+		{
+		public:
+			virtual ~Progress() {}
+			// done und total sind Oids; false..Operation abbrechen
+			virtual bool step( quint64 done, quint64 total ) = 0;
+		};
 		Database( QObject* = 0 );
 		~Database();
 
@@ -41,14 +55,52 @@ namespace Sdb
 		Atom getAtom( const QByteArray& name, bool create = true );
 		QByteArray getAtomString( Atom );
 
-		Index createIndex( const QByteArray& name, const IndexMeta& );
+		// Indiziert auch alle bestehenden Records; 0..durch Progress abgebrochen
+		Index createIndex( const QByteArray& name, const IndexMeta&, Progress* = 0 );
 		Index findIndex( const QByteArray& name );
 		bool getIndexMeta( Index, IndexMeta& );
 		QList<Index> findIndexForAtom( Atom atom );
+		QList<Index> getIndexes(); // alle Indizes der Datenbank
+
+		// Alle Objekte mit dem gegebenen FieldType, aufsteigend nach Oid, Stand des letzten Commit.
+		// Der Typindex wird nur mit createTypeIndex() angelegt, da dabei alle Records gelesen
+		// werden; erst ab dann wird er beim Commit nachgefhrt.
+		Oit objectsOfType( Atom type );
+		void createTypeIndex();
+		bool hasTypeIndex() const { return d_meta.d_typTable != 0; }
+		// Rids der Relationen vom Typ type (0..ohne Typ), bei denen obj auf den gegebenen
+		// Seiten steht; aus dem Adjazenz-Index, Stand des letzten Commit. Reflexive nur einmal.
+		// Der Index wird nur mit createRelationIndex() angelegt, da dabei alle Records gelesen
+		// werden; erst ab dann wird er beim Commit nachgefhrt.
+		enum RelSide { SourceSide = 1, TargetSide = 2, AnySide = SourceSide | TargetSide };
+		QList<OID> findRelations( OID obj, Atom type, quint8 sides = AnySide, 
+			quint32 max = 0xffffffff );
+		quint32 countRelations( OID obj, Atom type, quint8 sides = AnySide ); // ohne Liste
+		void createRelationIndex();
+		bool hasRelationIndex() const { return d_meta.d_adjTable != 0; }
+		// Optionaler Bloom-Filter fr derefUuid; der Aufbau liest alle Uuids
+		void createUuidFilter();
+		bool hasUuidFilter() const { return d_meta.d_uuidBloom; }
 
 		void checkUsed( OID );
 		OID getMaxOid() { return getNextOid( false ); }
 
+		// Feldwerte, deren Serialisierung grsser als limit Bytes ist, werden ausserhalb
+		// des Records in der valTable gespeichert und erst bei Bedarf geladen. 0..nie
+		void setValueLimit( quint32 limit ) { d_valueLimit = limit; }
+		quint32 getValueLimit() const { return d_valueLimit; }
+
+		// Records und ausgelagerte Feldwerte, deren Abbild mindestens limit Bytes gross ist, 
+		// werden mit zlib komprimiert gespeichert. Die Einstellung wird in der Datenbank 
+		// persistiert. Beim ersten Einschalten wird aus den bestehenden Records ein Wrterbuch
+		// trainiert und ebenfalls persistiert; es bleibt danach unverndert, da die damit
+		// komprimierten Abbilder darauf angewiesen sind. Ohne Records vorerst ohne Wrterbuch.
+		// 0..aus
+		void setCompression( quint32 limit );
+		quint32 getCompression() const { return d_meta.d_zipLimit; }
+		// Verhltnis unkomprimiert zu gespeichert aller seit open() geschriebenen Records und Werte
+		double getCompressionRatio() const;
+
 		void addObserver( QObject*, const char* slot );
 		void removeObserver( QObject*, const char* slot );
 
@@ -61,20 +113,53 @@ namespace Sdb
 		void doCheckUsed( quint64 ); // OID
 	protected slots:
 		void onCheckUsed( quint64 ); // OID
-	private: // nur fr Transaction zugnglich
+	private: // nur fr Transaction, BulkWriter und IndexEngine zugnglich
 		friend class Transaction;
+		friend class BulkWriter;
+		friend class IndexEngine;
+		friend class Oit;
+		friend class Query;
+		friend class ::SdbTests;
 		RecordImp* getOrLoadRecord( quint64 );
-		void saveRecord( RecordImp* );
+		// Ldt alle noch nicht im Cache vorhandenen Records mit einem Cursor in Oid-Reihenfolge;
+		// parallel..Dekodierung in Worker-Threads
+		void loadRecords( const QList<OID>&, bool parallel );
+		void saveRecord( RecordImp*, const Record::Fields* changed = 0 ); // changed==0..alle
+		void writeRecord( RecordImp*, const Record::Fields* changed, BtreeBatch& );
 		void eraseRecord( RecordImp* );
+		void eraseRecord( RecordImp*, BtreeBatch& );
 		int getObjTable();
 		int getStrTable();
 		int getDirTable();
 		int getIdxTable();
 		int getQueTable();
 		int getMapTable();
+		int getLstTable();
+		int getValTable();
+		int getTypTable() const { return d_meta.d_typTable; } // 0..nicht angelegt
+		int buildTypTable(); // legt den Typindex an und trgt alle bestehenden Objekte nach
+		int getAdjTable() const { return d_meta.d_adjTable; } // 0..nicht angelegt
+		int buildAdjTable(); // legt den Adjazenz-Index an und trgt alle Relationen nach
+		int getCntTable();
+		int getBlmTable();
+		// Bloom-Filter des Tables (objTable mit createUuidFilter oder Index mit IndexMeta::d_bloom);
+		// wird beim ersten Zugriff geladen, fehlt er oder ist er berladen, nur im Speicher
+		// neu aufgebaut und beim nchsten addToBloom ganz geschrieben. 0..kein Filter
+		Bloom* getBloom( int table );
+		Bloom* loadBloom( int table );
+		Bloom* buildBloom( int table ); // liest den Table, schreibt nichts
+		void storeBloom( int table ); // aufbauen und speichern, fr createIndex und createUuidFilter
+		void saveBloom( int table, const Bloom*, BtreeBatch& );
+		void addToBloom( int table, const QByteArray&, BtreeBatch& );
+		void checkBlooms(); // nach dem Schreiben eines Batch; verwirft berladene Filter
+		static QByteArray typeKey( Atom, OID );
+		static QByteArray adjKey( OID obj, quint8 side, Atom type, OID rid = 0 ); // rid 0..Prefix
+		QByteArray readImage( const QByteArray& ) const;
+		QByteArray writeImage( const QByteArray& );
+		QByteArray trainDictionary();
 		quint32 getNextQueueNr(quint64 oid);
 		quint32 getNextSid();
-		OID getNextOid(bool persist = true);
+		OID getNextOid(bool persist = true, quint32 count = 1); // count..Block reservieren
 		void checkOpen() const;
 		void loadMeta();
 		void saveMeta();
@@ -86,6 +171,7 @@ namespace Sdb
 		bool loadStreamMeta( quint32, StreamMeta& ); // false..not found
 		quint64 derefUuid( const QUuid& );
 		void setUuid( quint64 orl, const QUuid& ); // orl==0..remove
+		void setUuid( quint64 orl, const QUuid&, BtreeBatch& );
 		RecordImp* createRecord( Record::Type type );
 
 	private: // nur fr Idx zugnglich
@@ -94,12 +180,20 @@ namespace Sdb
 		friend class Mit;
 		BtreeStore* getStore() const { return d_db; }
 
+	private: // nur fr RecordImp zugnglich
+		friend class RecordImp;
+		bool loadValue( OID, Atom, Stream::DataCell& ); // false..not found
+		void saveValues( RecordImp*, const QMap<Atom,QByteArray>& large, 
+			const Record::Fields* changed, BtreeBatch& );
+
 	private: // nur fr Database und Lock zugnglich
 		friend class Lock;
 
 		struct Meta
 		{
-			Meta():d_objTable(0),d_dirTable(0),d_strTable(0),d_idxTable(0),d_queTable(0),d_mapTable(0) {}
+			Meta():d_objTable(0),d_dirTable(0),d_strTable(0),d_idxTable(0),d_queTable(0),d_mapTable(0),
+				d_valTable(0),d_typTable(0),d_cntTable(0),d_blmTable(0),d_lstTable(0),d_adjTable(0),
+				d_zipLimit(0),d_uuidBloom(false) {}
 
 			int d_objTable; // Btree mit ID->Record und UUID->ID
 			int d_dirTable; // Btree mit Atom->Name und Name->Atom
@@ -107,6 +201,15 @@ namespace Sdb
 			int d_idxTable; // Btree mit ID->Indexdef und Atom, ID um Indizes aufzufinden
 			int d_queTable; // Btree mit <oid> <nr> -> <cell>
 			int d_mapTable; // Btree mit <oid> [ <cell> ]* -> <cell>
+			int d_valTable; // Btree mit <oid> <atom> -> <cell>, ausgelagerte grosse Feldwerte
+			int d_typTable; // Btree ohne Daten mit <atom> <oid 8B BE>, Objekte nach FieldType
+			int d_cntTable; // Btree mit <idx> <items> -> <count> [ <cell> ]*, siehe IndexMeta::d_counted
+			int d_blmTable; // Btree mit <table> [ <block> ] -> Bloom-Filter bzw. dessen Kopf
+			int d_lstTable; // Btree mit <oid> <nr> -> Chunk bzw. Verzeichnis, siehe ElemList
+			int d_adjTable; // Btree ohne Daten mit <oid> <side> <atom> <rid>, Relationen pro Objekt
+			quint32 d_zipLimit; // Records ab dieser Grsse komprimieren, 0..nie
+			QByteArray d_zipDict; // zlib-Wrterbuch der Datenbank, leer..keines
+			bool d_uuidBloom; // Bloom-Filter ber die Uuids in objTable, siehe createUuidFilter
 		};
 		Meta d_meta;
 
@@ -120,6 +223,14 @@ namespace Sdb
 		QHash<quint32,int> d_streamLocks; // negativ..writelock, positiv..readlocks
 		QHash<Index,IndexMeta> d_idxMeta; // Cache, bleibt im Speicher
 		QHash<Atom,QList<Index> > d_idxAtoms; // Cache von Atom -> Idx
+		QList<Index> d_idxAll; // Cache aller Indizes
+		bool d_idxAllValid;
+		QHash<int,Bloom*> d_blooms; // Cache, 0..Table ohne Filter
+		QSet<int> d_bloomDirty; // im Speicher neu aufgebaut, noch nicht gespeichert
+		QCache<QByteArray,OID> d_uuids; // Cache Uuid-Zelle -> Oid, 0..nicht vorhanden
+		quint32 d_valueLimit;
+		quint64 d_rawBytes; // Statistik fr getCompressionRatio
+		quint64 d_storedBytes;
 	};
 }
 
@@ -0,0 +1,403 @@
+/*
+* Copyright 2005-2017 Rochus Keller <mailto:me@rochus-keller.info>
+*
+* This file is part of the DoorScope Sdb library.
+*
+* The following is the license that applies to this copy of the
+* library. For a license to use the library under conditions
+* other than those described here, please email to me@rochus-keller.info.
+*
+* GNU General Public License Usage
+* This file may be used under the terms of the GNU General Public
+* License (GPL) versions 2.0 or 3.0 as published by the Free Software
+* Foundation and appearing in the file LICENSE.GPL included in
+* the packaging of this file. Please review the following information
+* to ensure GNU General Public Licensing requirements will be met:
+* http://www.fsf.org/licensing/licenses/info/GPLv2.html and
+* http://www.gnu.org/copyleft/gpl.html.
+*/
+
+#include "ElemList.h"
+#include "Record.h"
+#include "Transaction.h"
+#include "Exceptions.h"
+#include <Stream/DataCell.h>
+#include <QtEndian>
+using namespace Sdb;
+using namespace Stream;
+
+ElemList::ElemList( Transaction* txn, Record* list ):d_txn(txn),d_list(list)
+{
+}
+
+QByteArray ElemList::makeKey( OID list, quint32 nr )
+{
+	return DataCell().setOid( list ).writeCell() + DataCell().setUInt32( nr ).writeCell();
+}
+
+QByteArray ElemList::writeDir( const Dir& dir )
+{
+	// Format: <next 4B BE> { <nr 4B BE> <end 4B BE> }*
+	QByteArray res( 4 + dir.d_entries.size() * 8, 0 );
+	uchar* p = (uchar*)res.data();
+	qToBigEndian<quint32>( dir.d_next, p );
+	p += 4;
+	for( int i = 0; i < dir.d_entries.size(); i++ )
+	{
+		qToBigEndian<quint32>( dir.d_entries[i].d_nr, p );
+		qToBigEndian<quint32>( dir.d_entries[i].d_end, p + 4 );
+		p += 8;
+	}
+	return res;
+}
+
+bool ElemList::readDir( const QByteArray& in, Dir& dir )
+{
+	dir = Dir();
+	if( in.size() < 4 )
+		return false;
+	const uchar* p = (const uchar*)in.constData();
+	dir.d_next = qFromBigEndian<quint32>( p );
+	p += 4;
+	const int n = ( in.size() - 4 ) / 8;
+	dir.d_entries.resize( n );
+	for( int i = 0; i < n; i++ )
+	{
+		dir.d_entries[i].d_nr = qFromBigEndian<quint32>( p );
+		dir.d_entries[i].d_end = qFromBigEndian<quint32>( p + 4 );
+		p += 8;
+	}
+	return true;
+}
+
+int ElemList::Dir::findPos( quint32 pos ) const
+{
+	// Erster Eintrag mit d_end > pos
+	int lo = 0;
+	int hi = d_entries.size();
+	while( lo < hi )
+	{
+		const int mid = ( lo + hi ) / 2;
+		if( d_entries[mid].d_end > pos )
+			hi = mid;
+		else
+			lo = mid + 1;
+	}
+	return lo;
+}
+
+void ElemList::Buffer::reindex()
+{
+	d_entry.clear();
+	for( int i = 0; i < d_dir.d_entries.size(); i++ )
+		d_entry[d_dir.d_entries[i].d_nr] = i;
+}
+
+void ElemList::flush( const Buffer& b, QMap<quint32,QByteArray>& chunks )
+{
+	if( !b.d_dirty )
+		return;
+	QMap<quint32,Chunk>::const_iterator i;
+	for( i = b.d_chunks.begin(); i != b.d_chunks.end(); ++i )
+		chunks[i.key()] = ( i.value().isEmpty() )?QByteArray():writeChunk( i.value() );
+	chunks[0] = ( b.d_indexed )?writeDir( b.d_dir ):QByteArray();
+}
+
+QByteArray ElemList::writeChunk( const Chunk& c )
+{
+	// Format: { <id 8B BE> }*
+	QByteArray res( c.size() * 8, 0 );
+	uchar* p = (uchar*)res.data();
+	for( int i = 0; i < c.size(); i++ )
+	{
+		qToBigEndian<quint64>( c[i], p );
+		p += 8;
+	}
+	return res;
+}
+
+void ElemList::readChunk( const QByteArray& in, Chunk& c )
+{
+	const int n = in.size() / 8;
+	c.resize( n );
+	const uchar* p = (const uchar*)in.constData();
+	for( int i = 0; i < n; i++ )
+	{
+		c[i] = qFromBigEndian<quint64>( p );
+		p += 8;
+	}
+}
+
+QByteArray ElemList::writeChildList( const QList<OID>& ids )
+{
+	// Format: <count 4B BE> { <oid 8B BE> }*; der Kopf unterscheidet leer von nicht materialisiert
+	QByteArray img( 4, 0 );
+	qToBigEndian<quint32>( ids.size(), (uchar*)img.data() );
+	return img + writeChunk( Chunk::fromList( ids ) );
+}
+
+bool ElemList::readChildList( const QByteArray& in, QList<OID>& ids )
+{
+	ids.clear();
+	if( in.size() < 4 )
+		return false;
+	Chunk c;
+	readChunk( in.mid( 4 ), c );
+	ids = c.toList();
+	return true;
+}
+
+const ElemList::Dir* ElemList::loadDir() const
+{
+	const Buffer* b = d_txn->peekElems( d_list );
+	if( b != 0 )
+		return ( b->d_indexed )?&b->d_dir:0;
+	QByteArray img;
+	d_txn->getChunk( d_list, 0, img );
+	if( !readDir( img, d_dir ) )
+		return 0;
+	return &d_dir;
+}
+
+ElemList::Buffer* ElemList::edit()
+{
+	Buffer* b = d_txn->editElems( d_list );
+	if( !b->d_indexed )
+		return 0;
+	return b;
+}
+
+void ElemList::loadChunk( quint32 nr, Chunk& c ) const
+{
+	const Buffer* b = d_txn->peekElems( d_list );
+	if( b != 0 )
+	{
+		QMap<quint32,Chunk>::const_iterator i = b->d_chunks.find( nr );
+		if( i != b->d_chunks.end() )
+		{
+			c = i.value();
+			return;
+		}
+	}
+	QByteArray img;
+	d_txn->getChunk( d_list, nr, img );
+	readChunk( img, c );
+}
+
+ElemList::Chunk& ElemList::editChunk( Buffer& b, quint32 nr )
+{
+	QMap<quint32,Chunk>::iterator i = b.d_chunks.find( nr );
+	if( i != b.d_chunks.end() )
+		return i.value();
+	Chunk c;
+	loadChunk( nr, c );
+	return b.d_chunks.insert( nr, c ).value();
+}
+
+quint32 ElemList::chunkOf( Record* elem ) const
+{
+	DataCell v;
+	d_txn->getField( elem, Record::FieldChunk, v );
+	if( v.getType() != DataCell::TypeUInt32 )
+		throw DatabaseException( DatabaseException::RecordFormat, "element without chunk" );
+	return v.getUInt32();
+}
+
+int ElemList::findEntry( const Buffer& b, quint32 nr )
+{
+	QHash<quint32,int>::const_iterator i = b.d_entry.find( nr );
+	if( i == b.d_entry.end() )
+		throw DatabaseException( DatabaseException::RecordFormat, "chunk not in directory" );
+	return i.value();
+}
+
+bool ElemList::isIndexed() const
+{
+	return loadDir() != 0;
+}
+
+quint32 ElemList::getCount() const
+{
+	const Dir* dir = loadDir();
+	if( dir == 0 )
+		return walk( 0, 0xffffffff ).size();
+	return dir->getCount();
+}
+
+OID ElemList::getAt( quint32 pos ) const
+{
+	const QList<OID> res = getRange( pos, 1 );
+	if( res.isEmpty() )
+		return 0;
+	else
+		return res.first();
+}
+
+QList<OID> ElemList::getRange( quint32 from, quint32 count ) const
+{
+	const Dir* dir = loadDir();
+	if( dir == 0 )
+		return walk( from, count );
+	QList<OID> res;
+	// Nur die Chunks laden, welche den Bereich berdecken
+	for( int i = dir->findPos( from ); i < dir->d_entries.size() && quint32(res.size()) < count; i++ )
+	{
+		const quint32 base = dir->getBegin( i );
+		Chunk c;
+		loadChunk( dir->d_entries[i].d_nr, c );
+		for( int j = ( from > base )?( from - base ):0; 
+			j < c.size() && quint32(res.size()) < count; j++ )
+			res.append( c[j] );
+	}
+	return res;
+}
+
+QList<OID> ElemList::walk( quint32 from, quint32 count ) const
+{
+	QList<OID> res;
+	quint32 pos = 0;
+	OID id = d_txn->getIdField( d_list, Record::FieldFirstElm );
+	while( id != 0 && quint32(res.size()) < count )
+	{
+		if( pos >= from )
+			res.append( id );
+		pos++;
+		Record* elem = d_txn->getRecord( id, Record::TypeElement );
+		if( elem == 0 )
+			throw DatabaseException( DatabaseException::RecordFormat );
+		id = d_txn->getIdField( elem, Record::FieldNextElem );
+	}
+	return res;
+}
+
+void ElemList::clear()
+{
+	Buffer* b = edit();
+	if( b == 0 )
+		return;
+	for( int i = 0; i < b->d_dir.d_entries.size(); i++ )
+		b->d_chunks[b->d_dir.d_entries[i].d_nr] = Chunk();
+	b->d_dir = Dir();
+	b->d_entry.clear();
+	b->d_indexed = false;
+	b->d_dirty = true;
+}
+
+void ElemList::build()
+{
+	clear();
+	Buffer* b = d_txn->editElems( d_list );
+	Dir& dir = b->d_dir;
+	Chunk c;
+	OID id = d_txn->getIdField( d_list, Record::FieldFirstElm );
+	while( id != 0 )
+	{
+		Record* elem = d_txn->getRecord( id, Record::TypeElement );
+		if( elem == 0 )
+			throw DatabaseException( DatabaseException::RecordFormat );
+		if( c.size() == ChunkSize )
+		{
+			b->d_chunks[dir.d_next] = c;
+			dir.d_entries.append( Entry( dir.d_next++, dir.getCount() + c.size() ) );
+			c.clear();
+		}
+		c.append( id );
+		d_txn->setField( elem, Record::FieldChunk, DataCell().setUInt32( dir.d_next ) );
+		id = d_txn->getIdField( elem, Record::FieldNextElem );
+	}
+	if( !c.isEmpty() )
+	{
+		b->d_chunks[dir.d_next] = c;
+		dir.d_entries.append( Entry( dir.d_next++, dir.getCount() + c.size() ) );
+	}
+	b->reindex();
+	b->d_indexed = true;
+	b->d_dirty = true;
+}
+
+void ElemList::split( Buffer& b, int e, bool append )
+{
+	// Beim Anhngen am Ende der Liste nur das neue Element auslagern, damit fortlaufend
+	// erzeugte Listen volle Chunks haben; sonst die hintere Hlfte.
+	Chunk& c = b.d_chunks[b.d_dir.d_entries[e].d_nr];
+	const int half = ( append )?( c.size() - 1 ):( c.size() / 2 );
+	const quint32 nr = b.d_dir.d_next++;
+	Chunk tail;
+	for( int i = half; i < c.size(); i++ )
+	{
+		Record* elem = d_txn->getRecord( c[i], Record::TypeElement );
+		if( elem == 0 )
+			throw DatabaseException( DatabaseException::RecordFormat );
+		d_txn->setField( elem, Record::FieldChunk, DataCell().setUInt32( nr ) );
+		tail.append( c[i] );
+	}
+	c.resize( half );
+	const quint32 end = b.d_dir.d_entries[e].d_end;
+	b.d_dir.d_entries[e].d_end = b.d_dir.getBegin( e ) + c.size();
+	b.d_dir.d_entries.insert( e + 1, Entry( nr, end ) );
+	b.d_chunks[nr] = tail;
+	b.reindex();
+}
+
+void ElemList::insert( Record* elem, Record* ref, bool before )
+{
+	Buffer* b = edit();
+	if( b == 0 )
+		return;
+	Dir& dir = b->d_dir;
+	int e;
+	if( ref == 0 )
+	{
+		if( dir.d_entries.isEmpty() )
+		{
+			dir.d_entries.append( Entry( dir.d_next++, 0 ) );
+			b->reindex();
+		}
+		e = ( before )?0:( dir.d_entries.size() - 1 );
+	}else
+		e = findEntry( *b, chunkOf( ref ) );
+	const quint32 nr = dir.d_entries[e].d_nr;
+	Chunk& c = editChunk( *b, nr );
+	int pos;
+	if( ref == 0 )
+		pos = ( before )?0:c.size();
+	else
+	{
+		pos = c.indexOf( ref->getId() );
+		if( pos < 0 )
+			throw DatabaseException( DatabaseException::RecordFormat, "element not in chunk" );
+		if( !before )
+			pos++;
+	}
+	c.insert( pos, elem->getId() );
+	// Die kumulierten Anzahlen ab hier nachfhren; beim Anhngen nur der letzte Eintrag
+	for( int i = e; i < dir.d_entries.size(); i++ )
+		dir.d_entries[i].d_end++;
+	d_txn->setField( elem, Record::FieldChunk, DataCell().setUInt32( nr ) );
+	if( c.size() > ChunkSize )
+		split( *b, e, pos == c.size() - 1 && e == dir.d_entries.size() - 1 );
+	b->d_dirty = true;
+}
+
+void ElemList::remove( Record* elem )
+{
+	Buffer* b = edit();
+	if( b == 0 )
+		return;
+	Dir& dir = b->d_dir;
+	const int e = findEntry( *b, chunkOf( elem ) );
+	const quint32 nr = dir.d_entries[e].d_nr;
+	Chunk& c = editChunk( *b, nr );
+	const int pos = c.indexOf( elem->getId() );
+	if( pos < 0 )
+		throw DatabaseException( DatabaseException::RecordFormat, "element not in chunk" );
+	c.remove( pos );
+	for( int i = e; i < dir.d_entries.size(); i++ )
+		dir.d_entries[i].d_end--;
+	if( c.isEmpty() )
+	{
+		dir.d_entries.remove( e ); // der leere Chunk wird beim Commit gelscht
+		b->reindex();
+	}
+	b->d_dirty = true;
+}
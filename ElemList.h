@@ -0,0 +1,112 @@
+#ifndef __Sdb_ElemList__
+#define __Sdb_ElemList__
+
+
+/*
+* Copyright 2005-2017 Rochus Keller <mailto:me@rochus-keller.info>
+*
+* This file is part of the DoorScope Sdb library.
+*
+* The following is the license that applies to this copy of the
+* library. For a license to use the library under conditions
+* other than those described here, please email to me@rochus-keller.info.
+*
+* GNU General Public License Usage
+* This file may be used under the terms of the GNU General Public
+* License (GPL) versions 2.0 or 3.0 as published by the Free Software
+* Foundation and appearing in the file LICENSE.GPL included in
+* the packaging of this file. Please review the following information
+* to ensure GNU General Public Licensing requirements will be met:
+* http://www.fsf.org/licensing/licenses/info/GPLv2.html and
+* http://www.gnu.org/copyleft/gpl.html.
+
+#include <QVector>
+#include <QList>
+#include <QMap>
+#include <QHash>
+#include <QByteArray>
+#include <Sdb/Globals.h>
+
+namespace Sdb
+{
+	class Record;
+	class Transaction;
+
+	// Optionaler Positionsindex ber die Elementeliste eines Objekts. Die Element-Ids sind in
+	// Chunks zu hchstens ChunkSize gruppiert; ein Verzeichnis pro Liste fhrt die Chunks in
+	// Listenreihenfolge mit der kumulierten Anzahl, jedes Element kennt seinen Chunk ber
+	// FieldChunk. Die verkettete Liste bleibt massgebend. Listen ohne Verzeichnis werden erst
+	// mit build() (Obj::indexElems) indiziert, bis dahin wird die Liste abgeschritten.
+	// Verzeichnis und genderte Chunks werden pro Transaktion dekodiert im RecordCow gehalten
+	// und erst beim Commit kodiert.
+	// Ablage in Database::getLstTable() mit <oid> <nr> -> Chunk, nr 0 ist das Verzeichnis.
+	class ElemList
+	{
+	public:
+		enum { ChunkSize = 256, 
+			ChildList = 0xffffffff // nr der optionalen Kindliste eines Aggregats, siehe Obj::indexObjs
+		};
+		struct Entry
+		{
+			quint32 d_nr;
+			quint32 d_end; // Anzahl Elemente bis und mit diesem Chunk
+			Entry( quint32 nr = 0, quint32 end = 0 ):d_nr(nr),d_end(end) {}
+		};
+		struct Dir
+		{
+			quint32 d_next; // nchste freie Chunk-Nummer
+			QVector<Entry> d_entries;
+			Dir():d_next(1) {}
+			quint32 getCount() const { return ( d_entries.isEmpty() )?0:d_entries.last().d_end; }
+			quint32 getBegin( int e ) const { return ( e > 0 )?d_entries[e-1].d_end:0; }
+			int findPos( quint32 pos ) const; // Eintrag mit pos, d_entries.size()..ausserhalb
+		};
+		typedef QVector<OID> Chunk;
+		// Stand einer Liste in der laufenden Transaktion, siehe Transaction::getElems
+		struct Buffer
+		{
+			bool d_indexed; // false..kein Verzeichnis
+			bool d_dirty;
+			Dir d_dir;
+			QHash<quint32,int> d_entry; // nr -> Index in d_dir.d_entries
+			QMap<quint32,Chunk> d_chunks; // genderte Chunks, leer..lschen
+			Buffer():d_indexed(false),d_dirty(false) {}
+			void reindex();
+		};
+
+		ElemList( Transaction*, Record* list );
+
+		bool isIndexed() const;
+		quint32 getCount() const;
+		OID getAt( quint32 pos ) const; // 0..ausserhalb der Liste
+		QList<OID> getRange( quint32 from, quint32 count ) const;
+		void build(); // Verzeichnis und Chunks aus der verketteten Liste neu aufbauen
+		void clear(); // Verzeichnis und Chunks entfernen
+		// Nach dem Verketten aufrufen; ref 0..am Anfang (before) bzw. am Ende der Liste
+		void insert( Record* elem, Record* ref, bool before );
+		void remove( Record* elem ); // vor dem Entketten aufrufen
+
+		static QByteArray makeKey( OID list, quint32 nr );
+		static void flush( const Buffer&, QMap<quint32,QByteArray>& chunks ); // fr Commit
+		static QByteArray writeDir( const Dir& );
+		static bool readDir( const QByteArray&, Dir& ); // false..kein Verzeichnis
+		static QByteArray writeChunk( const Chunk& );
+		static void readChunk( const QByteArray&, Chunk& );
+		static QByteArray writeChildList( const QList<OID>& );
+		static bool readChildList( const QByteArray&, QList<OID>& ); // false..nicht materialisiert
+		QList<OID> walk( quint32 from, quint32 count ) const; // entlang der verketteten Liste
+	private:
+		const Dir* loadDir() const; // 0..kein Verzeichnis
+		Buffer* edit(); // 0..kein Verzeichnis
+		void loadChunk( quint32 nr, Chunk& ) const;
+		Chunk& editChunk( Buffer&, quint32 nr ); // einmal dekodiert, beim Commit kodiert
+		quint32 chunkOf( Record* elem ) const;
+		static int findEntry( const Buffer&, quint32 nr );
+		void split( Buffer&, int entry, bool append );
+		Transaction* d_txn;
+		Record* d_list;
+		mutable Dir d_dir; // Verzeichnis ohne Buffer
+	};
+}
+
+#endif // __Sdb_ElemList__
@@ -0,0 +1,121 @@
+/*
+* Copyright 2005-2017 Rochus Keller <mailto:me@rochus-keller.info>
+*
+* This file is part of the DoorScope Sdb library.
+*
+* The following is the license that applies to this copy of the
+* library. For a license to use the library under conditions
+* other than those described here, please email to me@rochus-keller.info.
+*
+* GNU General Public License Usage
+* This file may be used under the terms of the GNU General Public
+* License (GPL) versions 2.0 or 3.0 as published by the Free Software
+* Foundation and appearing in the file LICENSE.GPL included in
+* the packaging of this file. Please review the following information
+* to ensure GNU General Public Licensing requirements will be met:
+* http://www.fsf.org/licensing/licenses/info/GPLv2.html and
+* http://www.gnu.org/copyleft/gpl.html.
+*/
+
+#include "Ftx.h"
+#include "Exceptions.h"
+#include "BtreeCursor.h"
+#include "Transaction.h"
+#include "IndexEngine.h"
+#include "OidSet.h"
+using namespace Sdb;
+
+Ftx::Ftx( Transaction* txn, Index idx ):d_txn(txn),d_idx(idx)
+{
+}
+
+void Ftx::checkNull() const
+{
+	if( d_idx == 0 )
+		throw DatabaseException(DatabaseException::AccessRecord, "null");
+}
+
+QList<OID> Ftx::lookup( const QString& word, bool prefix ) const
+{
+	checkNull();
+	Database::Lock lock( d_txn->getDb(), false );
+	IndexMeta meta;
+	if( !d_txn->getDb()->getIndexMeta( d_idx, meta ) || meta.d_kind != IndexMeta::Fulltext )
+		throw DatabaseException( DatabaseException::WrongType, "not a fulltext index" );
+	QByteArray key = IndexEngine::makeTerm( meta.d_items.first(), word );
+	if( key.isEmpty() )
+		return QList<OID>();
+	if( !prefix )
+		key += char(0);
+	// Die Zeilen eines Worts sind nach Block sortiert, bei Prfixen werden die Listen
+	// der einzelnen Wrter vereinigt.
+	QList<OID> res;
+	QList<OID> cur;
+	QByteArray term;
+	BtreeCursor c;
+	c.open( d_txn->getDb()->getStore(), d_idx );
+	if( c.moveTo( key, true ) ) do
+	{
+		const QByteArray k = c.readKey();
+		if( !k.startsWith( key ) )
+			break;
+		const QByteArray t = OidSet::termOf( k );
+		if( t != term )
+		{
+			res = OidSet::unite( res, cur );
+			cur.clear();
+			term = t;
+		}
+		OidSet::decode( c.readValue(), cur );
+	}while( c.moveNext() );
+	return OidSet::unite( res, cur );
+}
+
+QList<OID> Ftx::lookup( const QString& word ) const
+{
+	if( word.endsWith( QChar('*') ) )
+		return lookup( word.left( word.size() - 1 ), true );
+	else
+		return lookup( word, false );
+}
+
+QList<OID> Ftx::find( const QString& word ) const
+{
+	return lookup( word, false );
+}
+
+QList<OID> Ftx::findPrefix( const QString& prefix ) const
+{
+	return lookup( prefix, true );
+}
+
+QList<OID> Ftx::findAll( const QStringList& words ) const
+{
+	if( words.isEmpty() )
+		return QList<OID>();
+	// Mit der krzesten Liste beginnen, damit das Zwischenresultat klein bleibt
+	QList<QList<OID> > lists;
+	for( int i = 0; i < words.size(); i++ )
+	{
+		lists.append( lookup( words[i] ) );
+		if( lists.last().isEmpty() )
+			return QList<OID>();
+	}
+	int min = 0;
+	for( int i = 1; i < lists.size(); i++ )
+		if( lists[i].size() < lists[min].size() )
+			min = i;
+	QList<OID> res = lists[min];
+	for( int i = 0; i < lists.size() && !res.isEmpty(); i++ )
+		if( i != min )
+			res = OidSet::intersect( res, lists[i] );
+	return res;
+}
+
+QList<OID> Ftx::findAny( const QStringList& words ) const
+{
+	QList<OID> res;
+	for( int i = 0; i < words.size(); i++ )
+		res = OidSet::unite( res, lookup( words[i] ) );
+	return res;
+}
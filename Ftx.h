@@ -0,0 +1,56 @@
+#ifndef __Sdb_Ftx__
+#define __Sdb_Ftx__
+
+/*
+* Copyright 2005-2017 Rochus Keller <mailto:me@rochus-keller.info>
+*
+* This file is part of the DoorScope Sdb library.
+*
+* The following is the license that applies to this copy of the
+* library. For a license to use the library under conditions
+* other than those described here, please email to me@rochus-keller.info.
+*
+* GNU General Public License Usage
+* This file may be used under the terms of the GNU General Public
+* License (GPL) versions 2.0 or 3.0 as published by the Free Software
+* Foundation and appearing in the file LICENSE.GPL included in
+* the packaging of this file. Please review the following information
+* to ensure GNU General Public Licensing requirements will be met:
+* http://www.fsf.org/licensing/licenses/info/GPLv2.html and
+* http://www.gnu.org/copyleft/gpl.html.
+*/
+
+#include <QStringList>
+#include <QList>
+#include <Sdb/Globals.h>
+
+namespace Sdb
+{
+	class Transaction;
+
+	class Ftx // Fulltext
+	{
+	public:
+		Ftx( Transaction* = 0, Index idx = 0 );
+
+		// Die Wrter werden wie im Index normalisiert. Resultat sind aufsteigende Oids.
+		QList<OID> find( const QString& word ) const;
+		QList<OID> findPrefix( const QString& prefix ) const;
+		// Endet ein Wort mit '*', wird es als Prfix gesucht
+		QList<OID> findAll( const QStringList& words ) const; // AND
+		QList<OID> findAny( const QStringList& words ) const; // OR
+
+		bool isNull() const { return d_idx == 0; }
+		Transaction* getTxn() const { return d_txn; }
+		Index getIdx() const { return d_idx; }
+	protected:
+		void checkNull() const;
+		QList<OID> lookup( const QString& word, bool prefix ) const;
+		QList<OID> lookup( const QString& word ) const;
+	private:
+		Transaction* d_txn;
+		Index d_idx;
+	};
+}
+
+#endif
@@ -37,6 +37,12 @@ namespace Sdb
 			Value = 1,	// Mehrere Items zulssig. Diese werden einfach binr hintereinandergefgt.
 			Unique = 2, // Value, aber Wert der Items wird ohne nachgestellte ID gespeichert. Nur fr Value
 			Fulltext = 3, // Nur ein Item zulssig. Dieses wird in Wrter aufgespalten, falls Text.
+			Hash = 4, // Nur Gleichheit. Key ist ein 8 Byte Hash der Items ohne Collation plus ID; 
+					  // Treffer werden gegen den Record geprft.
+			Bitmap = 5, // Pro Wert der Items Oid-Mengen in Zeilen zu 2^16 Oids (siehe OidSet); 
+						// fr Felder mit wenigen verschiedenen Werten
+			Trigram = 6, // Nur ein Item zulssig. Oid-Mengen pro drei Bytes des kodierten Texts,
+						 // fr Suche nach Teilstrings
 		};
 		Kind d_kind;
 
@@ -51,15 +57,23 @@ namespace Sdb
 			quint32 d_atom; // Feld, das indiziert wird
 			bool d_nocase; // true..transformiere in Kleinbuchstaben vor Vergleich (falls Text)
 			bool d_invert; // true..invertiere Daten so dass absteigend sortiert wird
+			bool d_ordered; // true..Zahlen, Datum und Ids so kodieren, dass Bytefolge = Wertefolge
 
 			quint8 d_coll; // Collation
 
-			Item( quint32 atom = 0, Collation c = None, bool nc = true, bool inv = false ):
-				d_atom(atom),d_nocase(nc),d_invert(inv),d_coll(c) {}
+			Item( quint32 atom = 0, Collation c = None, bool nc = true, bool inv = false, 
+				bool ord = false ):
+				d_atom(atom),d_nocase(nc),d_invert(inv),d_ordered(ord),d_coll(c) {}
 		};
 		QList<Item> d_items;
+		QList<Atom> d_include; // Felder, deren Werte im Index-Eintrag mitgefhrt werden (nicht Fulltext)
+		bool d_counted; // true..pro Wert der Items einen Zhler beim Commit nachfhren (nur Value)
+		// Optionaler Filter; nur passende Records werden indiziert
+		QList<Atom> d_types; // Record::FieldType muss eines dieser Atome sein; leer..alle
+		QList<Atom> d_required; // Felder, die nicht null sein drfen
+		bool d_bloom; // true..Bloom-Filter ber die Items fr negative Idx::seek (Value, Unique, Hash)
 
-		IndexMeta(Kind k = Value):d_kind(k) {}
+		IndexMeta(Kind k = Value):d_kind(k),d_counted(false),d_bloom(false) {}
 	};
 }
 
@@ -22,20 +22,49 @@
 #include "BtreeStore.h"
 #include "BtreeCursor.h"
 #include "Transaction.h"
+#include "BtreeBatch.h"
+#include "Orl.h"
+#include "IndexEngine.h"
+#include "Bloom.h"
 #include <cassert>
+#include <Stream/DataReader.h>
+#include <QDateTime>
+#include <cstring>
 using namespace Sdb;
 using namespace Stream;
 
+// Vorberechnete Kodierung aller Latin1-Zeichen fr jede Kombination von nocase und
+// Collation. Die Eintrge werden mit Idx::collate erzeugt und liefern daher exakt
+// dieselben Bytes wie der zeichenweise Weg ber QString.
+struct _Code
+{
+	quint8 d_len;
+	char d_b[15];
+};
+struct Idx::Table
+{
+	_Code d_map[2][2][256]; // [nocase][collation][latin1]
+	Table();
+};
+
+const Idx::Table& Idx::table()
+{
+	static const Table s_table;
+	return s_table;
+}
+
 Idx::Idx( Transaction* txn, int idx )
 {
 	d_txn = txn;
 	d_idx = idx;
+	d_opts = 0;
 }
 
 Idx::Idx( const Idx& lhs )
 {
 	d_txn = 0;
 	d_idx = 0;
+	d_opts = 0;
 	*this = lhs;
 }
 
@@ -47,6 +76,10 @@ Idx& Idx::operator=( const Idx& r )
 	d_idx = r.d_idx;
 	d_cur = r.d_cur;
 	d_key = r.d_key;
+	d_lo = r.d_lo;
+	d_hi = r.d_hi;
+	d_opts = r.d_opts;
+	d_match = r.d_match;
 	return *this;
 }	
 
@@ -101,6 +134,20 @@ bool Idx::next()
 
 bool Idx::nextKey()
 {
+	if( !d_match.isEmpty() )
+	{
+		checkNull();
+		Database::Lock lock( d_txn->getDb(), false );
+		IndexMeta meta;
+		d_txn->getDb()->getIndexMeta( d_idx, meta );
+		BtreeCursor cur;
+		cur.open( d_txn->getDb()->getStore(), d_idx );
+		cur.moveTo( d_cur );
+		if( !cur.moveNext() || !skipMismatch( cur, meta ) )
+			return false;
+		d_cur = cur.readKey();
+		return true;
+	}
 	if( next() )
 		return d_cur.startsWith( d_key );
 	else
@@ -149,10 +196,16 @@ bool Idx::seek( const Stream::DataCell& key )
 	Database::Lock lock( d_txn->getDb(), false );
 	d_key.clear();
 	d_cur.clear();
+	d_hi.clear();
 	IndexMeta meta;
 	d_txn->getDb()->getIndexMeta( d_idx, meta );
 	assert( !meta.d_items.isEmpty() );
+	if( meta.d_kind == IndexMeta::Hash )
+		return seek( QList<Stream::DataCell>() << key );
+	d_match.clear();
 	addElement( d_key, meta.d_items[0], key );
+	if( meta.d_items.size() == 1 && !mayContain( meta, d_key ) )
+		return false;
 	BtreeCursor cur;
 	cur.open( d_txn->getDb()->getStore(), d_idx );
 	if( cur.moveTo( d_key, true ) )
@@ -172,6 +225,13 @@ bool Idx::firstKey()
 	cur.open( d_txn->getDb()->getStore(), d_idx );
 	if( cur.moveTo( d_key, true ) )
 	{
+		if( !d_match.isEmpty() )
+		{
+			IndexMeta meta;
+			d_txn->getDb()->getIndexMeta( d_idx, meta );
+			if( !skipMismatch( cur, meta ) )
+				return false;
+		}
 		d_cur = cur.readKey();
 		return true;
 	}else
@@ -194,21 +254,160 @@ bool Idx::seek( const QList<Stream::DataCell>& keys )
 	Database::Lock lock( d_txn->getDb(), false );
 	d_key.clear();
 	d_cur.clear();
+	d_hi.clear();
+	d_match.clear();
 	IndexMeta meta;
 	d_txn->getDb()->getIndexMeta( d_idx, meta );
-	for( int i = 0; i < keys.size() && i < meta.d_items.size(); i++ )
-		addElement( d_key, meta.d_items[i], keys[i] );
+	if( meta.d_kind == IndexMeta::Hash )
+	{
+		d_match = makeHashItems( meta, keys );
+		if( d_match.isEmpty() )
+			throw DatabaseException( DatabaseException::InvalidArgument, 
+				"hash index requires a value for every item" );
+		d_key = makeHash( d_match );
+	}else
+		for( int i = 0; i < keys.size() && i < meta.d_items.size(); i++ )
+			addElement( d_key, meta.d_items[i], keys[i] );
+	// Der Filter kennt nur vollstndige Keys
+	if( keys.size() == meta.d_items.size() && !mayContain( meta, d_key ) )
+		return false;
 	// TODO: was ist, wenn size von keys und meta.items nicht gleich?
 	BtreeCursor cur;
 	cur.open( d_txn->getDb()->getStore(), d_idx );
 	if( cur.moveTo( d_key, true ) )
 	{
+		if( !d_match.isEmpty() && !skipMismatch( cur, meta ) )
+			return false;
 		d_cur = cur.readKey();
 		return true;
 	}else
 		return false;
 }
 
+bool Idx::skipMismatch( BtreeCursor& cur, const IndexMeta& meta )
+{
+	// Kandidaten mit gleichem Hash, aber anderem Wert berspringen
+	while( true )
+	{
+		const QByteArray key = cur.readKey();
+		if( !key.startsWith( d_key ) )
+			return false;
+		if( matchesHash( meta, readValue( cur.readValue() ) ) )
+			return true;
+		if( !cur.moveNext() )
+			return false;
+	}
+}
+
+bool Idx::matchesHash( const IndexMeta& meta, OID id ) const
+{
+	Orl o = d_txn->getOrl( id );
+	if( o.isNull() )
+		return false;
+	Record::Fields f;
+	for( int i = 0; i < meta.d_items.size(); i++ )
+		f[meta.d_items[i].d_atom] = o.getValue( meta.d_items[i].d_atom );
+	QByteArray items;
+	return makeHashItems( meta, f, items ) && items == d_match;
+}
+
+QByteArray Idx::makeHashItems( const IndexMeta& meta, const QList<Stream::DataCell>& keys )
+{
+	QByteArray res;
+	if( keys.size() != meta.d_items.size() )
+		return res;
+	for( int i = 0; i < keys.size(); i++ )
+	{
+		if( keys[i].isNull() )
+			return QByteArray();
+		addHashElement( res, meta.d_items[i], keys[i] );
+	}
+	return res;
+}
+
+bool Idx::makeHashItems( const IndexMeta& meta, const Record::Fields& all, QByteArray& items )
+{
+	items.clear();
+	for( int j = 0; j < meta.d_items.size(); j++ )
+	{
+		Record::Fields::const_iterator it = all.find( meta.d_items[j].d_atom );
+		if( it == all.end() || it.value().isNull() )
+			return false;
+		addHashElement( items, meta.d_items[j], it.value() );
+	}
+	return true;
+}
+
+void Idx::addHashElement( QByteArray& out, const IndexMeta::Item& i, const Stream::DataCell& v )
+{
+	// Text aller Typen gleich behandeln, aber ohne Collation; mit Lnge, damit die 
+	// Aufteilung auf mehrere Items eindeutig bleibt
+	QByteArray cell;
+	switch( v.getType() )
+	{
+	case DataCell::TypeLatin1:
+	case DataCell::TypeAscii:
+		cell = ( i.d_nocase )?QString::fromLatin1( v.getArr() ).toLower().toUtf8():
+			QString::fromLatin1( v.getArr() ).toUtf8();
+		break;
+	case DataCell::TypeString:
+		cell = ( i.d_nocase )?v.getStr().toLower().toUtf8():v.getStr().toUtf8();
+		break;
+	default:
+		out += v.writeCell();
+		return;
+	}
+	out += DataCell::typeToSym( DataCell::TypeString );
+	out += DataCell().setUInt32( cell.size() ).writeCell();
+	out += cell;
+}
+
+QByteArray Idx::makeHash( const QByteArray& items )
+{
+	// FNV-1a 64 Bit
+	quint64 h = Q_UINT64_C(14695981039346656037);
+	for( int i = 0; i < items.size(); i++ )
+	{
+		h ^= quint8( items[i] );
+		h *= Q_UINT64_C(1099511628211);
+	}
+	QByteArray res( 8, 0 );
+	for( int i = 7; i >= 0; i-- )
+	{
+		res[i] = char( h & 0xff );
+		h >>= 8;
+	}
+	return res;
+}
+
+bool Idx::makeKey( const IndexMeta& meta, OID id, const Record::Fields& all, QByteArray& key )
+{
+	if( meta.d_kind == IndexMeta::Hash )
+	{
+		QByteArray items;
+		if( !makeHashItems( meta, all, items ) )
+			return false;
+		key = makeHash( items ) + DataCell().setId64( id ).writeCell();
+		return true;
+	}
+	if( meta.d_kind != IndexMeta::Value && meta.d_kind != IndexMeta::Unique && 
+		meta.d_kind != IndexMeta::Bitmap )
+		return false;
+	assert( !meta.d_items.isEmpty() );
+	key.clear();
+	key.reserve( 255 ); // RISK
+	for( int j = 0; j < meta.d_items.size(); j++ )
+	{
+		Record::Fields::const_iterator it = all.find( meta.d_items[j].d_atom );
+		if( it == all.end() || it.value().isNull() )
+			return false;
+		addElement( key, meta.d_items[j], it.value() );
+	}
+	if( meta.d_kind == IndexMeta::Value )
+		key += DataCell().setId64( id ).writeCell();
+	return true;
+}
+
 void Idx::addElement( QByteArray& out, const IndexMeta::Item& i, const Stream::DataCell& v )
 {
 	QByteArray cell;
@@ -216,10 +415,7 @@ void Idx::addElement( QByteArray& out, const IndexMeta::Item& i, const Stream::D
 	switch( v.getType() )
 	{
 	case DataCell::TypeLatin1:
-		if( i.d_nocase )
-			collate( cell, i.d_coll, QString::fromLatin1( v.getArr() ).toLower() );
-		else
-			collate( cell, i.d_coll, QString::fromLatin1( v.getArr() ) );
+		encode( cell, i, v.getArr() );
 		t = DataCell::TypeString; // Alle Textidx als UTF-8 speichern
 		break;
 	case DataCell::TypeAscii:
@@ -230,21 +426,16 @@ void Idx::addElement( QByteArray& out, const IndexMeta::Item& i, const Stream::D
 		t = DataCell::TypeString; // Alle Textidx als UTF-8 speichern
 		break;
 	case DataCell::TypeString:
-		if( i.d_nocase )
-			collate( cell, i.d_coll, v.getStr().toLower() );
-		else
-			collate( cell, i.d_coll, v.getStr() );
+		encode( cell, i, v.getStr() );
 		break;
 	default:
 		// Alle brigen Typen inkl. TypeHtml etc.
-		cell = v.writeCell(true);
+		if( !i.d_ordered || !encodeOrdered( cell, v ) )
+			cell = v.writeCell(true);
 		break;
 	}
 	if( i.d_invert )
-	{
-		for( int i = 0; i < cell.size(); i++ )
-			cell[i] = ~cell[i];
-	}
+		invert( cell );
 	out += DataCell::typeToSym( t ); // Damit Datentypen nicht durcheinander sortiert
 	out += cell;
 }
@@ -283,3 +474,563 @@ void Idx::collate( QByteArray& out, quint8 c, const QString& in )
 	}else
 		qWarning( "Idx::collate: unknown Collation" );
 }
+
+Idx::Table::Table()
+{
+	for( int nc = 0; nc < 2; nc++ )
+		for( int coll = 0; coll < 2; coll++ )
+			for( int ch = 0; ch < 256; ch++ )
+			{
+				QString in = QChar( ushort(ch) );
+				if( nc )
+					in = in.toLower();
+				QByteArray out;
+				Idx::collate( out, coll, in );
+				assert( out.size() <= int(sizeof(_Code::d_b)) );
+				_Code& c = d_map[nc][coll][ch];
+				c.d_len = out.size();
+				::memcpy( c.d_b, out.constData(), out.size() );
+			}
+}
+
+void Idx::encode( QByteArray& out, const IndexMeta::Item& i, const QString& in )
+{
+	if( i.d_coll > IndexMeta::NFKD_CanonicalBase )
+	{
+		collate( out, i.d_coll, ( i.d_nocase )?in.toLower():in );
+		return;
+	}
+	const _Code* map = table().d_map[(i.d_nocase)?1:0][i.d_coll];
+	const QChar* p = in.constData();
+	const int n = in.size();
+	const int start = out.size();
+	out.reserve( start + n + n / 2 );
+	int k = 0;
+	while( k < n )
+	{
+		if( p[k].unicode() < 0x100 )
+		{
+			const _Code& c = map[p[k].unicode()];
+			if( c.d_len == 1 )
+				out += c.d_b[0];
+			else
+				out.append( c.d_b, c.d_len );
+			k++;
+		}else
+		{
+			// Zeichen ausserhalb Latin1 zusammenhngend ber den bisherigen Weg
+			int e = k + 1;
+			while( e < n && p[e].unicode() >= 0x100 )
+				e++;
+			QString run( p + k, e - k );
+			if( i.d_nocase )
+				run = run.toLower();
+			QByteArray tmp;
+			collate( tmp, i.d_coll, run );
+			out += tmp;
+			k = e;
+		}
+	}
+#ifndef NDEBUG
+	QByteArray ref;
+	collate( ref, i.d_coll, ( i.d_nocase )?in.toLower():in );
+	assert( out.mid( start ) == ref );
+#endif
+}
+
+void Idx::encode( QByteArray& out, const IndexMeta::Item& i, const QByteArray& latin1 )
+{
+	if( i.d_coll > IndexMeta::NFKD_CanonicalBase )
+	{
+		encode( out, i, QString::fromLatin1( latin1 ) );
+		return;
+	}
+	// Kein Umweg ber QString ntig, jedes Byte ist direkt ein Tabelleneintrag
+	const _Code* map = table().d_map[(i.d_nocase)?1:0][i.d_coll];
+	const int n = latin1.size();
+	out.reserve( out.size() + n + n / 2 );
+	for( int k = 0; k < n; k++ )
+	{
+		const _Code& c = map[quint8( latin1[k] )];
+		if( c.d_len == 1 )
+			out += c.d_b[0];
+		else
+			out.append( c.d_b, c.d_len );
+	}
+}
+
+void Idx::invert( QByteArray& cell )
+{
+	// Wortweise statt byteweise; der Compiler kann die Schleife vektorisieren
+	char* p = cell.data();
+	int n = cell.size();
+	for( ; n >= 8; n -= 8, p += 8 )
+	{
+		quint64 w;
+		::memcpy( &w, p, 8 );
+		w = ~w;
+		::memcpy( p, &w, 8 );
+	}
+	for( ; n > 0; n--, p++ )
+		*p = ~*p;
+}
+
+template<class T>
+static inline void _writeBE( QByteArray& out, T v )
+{
+	for( int i = sizeof(T) - 1; i >= 0; i-- )
+		out += char( ( v >> ( i * 8 ) ) & 0xff );
+}
+
+bool Idx::encodeOrdered( QByteArray& out, const Stream::DataCell& v )
+{
+	// Big Endian mit fester Breite; bei vorzeichenbehafteten Zahlen wird das Vorzeichenbit
+	// gekippt, bei Gleitkommazahlen zustzlich alle Bits negativer Werte.
+	switch( v.getType() )
+	{
+	case DataCell::TypeBool:
+		out += char( ( v.getBool() )?1:0 );
+		return true;
+	case DataCell::TypeUInt8:
+		_writeBE<quint8>( out, v.getUInt8() );
+		return true;
+	case DataCell::TypeInt8:
+		_writeBE<quint8>( out, quint8( v.getInt8() ) ^ 0x80 );
+		return true;
+	case DataCell::TypeUInt16:
+		_writeBE<quint16>( out, v.getUInt16() );
+		return true;
+	case DataCell::TypeInt16:
+		_writeBE<quint16>( out, quint16( v.getInt16() ) ^ 0x8000 );
+		return true;
+	case DataCell::TypeUInt32:
+		_writeBE<quint32>( out, v.getUInt32() );
+		return true;
+	case DataCell::TypeInt32:
+		_writeBE<quint32>( out, quint32( v.getInt32() ) ^ 0x80000000 );
+		return true;
+	case DataCell::TypeUInt64:
+		_writeBE<quint64>( out, v.getUInt64() );
+		return true;
+	case DataCell::TypeInt64:
+		_writeBE<quint64>( out, quint64( v.getInt64() ) ^ Q_UINT64_C(0x8000000000000000) );
+		return true;
+	case DataCell::TypeFloat:
+		{
+			const float f = v.getFloat();
+			quint32 b;
+			::memcpy( &b, &f, 4 );
+			b = ( b & 0x80000000 )?~b:( b | 0x80000000 );
+			_writeBE<quint32>( out, b );
+		}
+		return true;
+	case DataCell::TypeDouble:
+		{
+			const double d = v.getDouble();
+			quint64 b;
+			::memcpy( &b, &d, 8 );
+			b = ( b & Q_UINT64_C(0x8000000000000000) )?~b:( b | Q_UINT64_C(0x8000000000000000) );
+			_writeBE<quint64>( out, b );
+		}
+		return true;
+	case DataCell::TypeDate:
+		_writeBE<quint32>( out, quint32( v.getDate().toJulianDay() ) ^ 0x80000000 );
+		return true;
+	case DataCell::TypeTime:
+		_writeBE<quint32>( out, QTime( 0, 0 ).msecsTo( v.getTime() ) );
+		return true;
+	case DataCell::TypeDateTime:
+		{
+			const QDateTime dt = v.getDateTime();
+			const qint64 ms = qint64( dt.date().toJulianDay() ) * 86400000 + 
+				QTime( 0, 0 ).msecsTo( dt.time() );
+			_writeBE<quint64>( out, quint64( ms ) ^ Q_UINT64_C(0x8000000000000000) );
+		}
+		return true;
+	case DataCell::TypeAtom:
+		_writeBE<quint32>( out, v.getAtom() );
+		return true;
+	case DataCell::TypeId32:
+		_writeBE<quint32>( out, v.getId32() );
+		return true;
+	case DataCell::TypeOid:
+		_writeBE<quint64>( out, v.getOid() );
+		return true;
+	case DataCell::TypeRid:
+		_writeBE<quint64>( out, v.getRid() );
+		return true;
+	case DataCell::TypeId64:
+		_writeBE<quint64>( out, v.getId64() );
+		return true;
+	default:
+		return false;
+	}
+}
+
+QByteArray Idx::makeBound( const IndexMeta& meta, const QList<Stream::DataCell>& keys )
+{
+	if( meta.d_kind == IndexMeta::Hash )
+	{
+		const QByteArray items = makeHashItems( meta, keys );
+		return ( items.isEmpty() )?QByteArray():makeHash( items );
+	}
+	QByteArray res;
+	for( int i = 0; i < keys.size() && i < meta.d_items.size(); i++ )
+		addElement( res, meta.d_items[i], keys[i] );
+	return res;
+}
+
+bool Idx::seekRange( const QList<Stream::DataCell>& lo, const QList<Stream::DataCell>& hi )
+{
+	checkNull();
+	Database::Lock lock( d_txn->getDb(), false );
+	d_key.clear();
+	d_cur.clear();
+	d_match.clear();
+	IndexMeta meta;
+	d_txn->getDb()->getIndexMeta( d_idx, meta );
+	if( meta.d_kind == IndexMeta::Hash )
+		throw DatabaseException( DatabaseException::InvalidArgument, 
+			"hash index supports equality only" );
+	d_lo.clear();
+	d_hi = makeBound( meta, hi );
+	d_opts = 0;
+	BtreeCursor cur;
+	cur.open( d_txn->getDb()->getStore(), d_idx );
+	cur.moveTo( makeBound( meta, lo ), true );
+	// moveTo ist auch bei false auf dem nchst grsseren Key, falls es einen gibt
+	if( cur.isValidPos() )
+	{
+		d_cur = cur.readKey();
+		return belowHi( d_cur );
+	}else
+		return false;
+}
+
+bool Idx::seekRange( const Stream::DataCell& lo, const Stream::DataCell& hi )
+{
+	return seekRange( QList<Stream::DataCell>() << lo, QList<Stream::DataCell>() << hi );
+}
+
+bool Idx::aboveLo( const QByteArray& key, const QByteArray& lo, int opts )
+{
+	// Die Grenzen werden als Prfix verglichen, d.h. mit dem Anfang des Keys in ihrer Lnge
+	if( lo.isEmpty() )
+		return true;
+	const QByteArray p = key.left( lo.size() );
+	return ( opts & ExcludeLo )?p > lo:p >= lo;
+}
+
+bool Idx::belowHi( const QByteArray& key, const QByteArray& hi, int opts )
+{
+	if( hi.isEmpty() )
+		return true;
+	const QByteArray p = key.left( hi.size() );
+	return ( opts & ExcludeHi )?p < hi:p <= hi;
+}
+
+bool Idx::aboveLo( const QByteArray& key ) const
+{
+	return aboveLo( key, d_lo, d_opts );
+}
+
+bool Idx::belowHi( const QByteArray& key ) const
+{
+	return belowHi( key, d_hi, d_opts );
+}
+
+bool Idx::nextInRange()
+{
+	if( next() )
+		return belowHi( d_cur );
+	else
+		return false;
+}
+
+static QByteArray _prefixEnd( QByteArray b )
+{
+	// Kleinster Key, der grsser ist als alle Keys mit Prfix b; leer..keiner
+	while( !b.isEmpty() && quint8( b[b.size()-1] ) == 0xff )
+		b.chop( 1 );
+	if( !b.isEmpty() )
+		b[b.size()-1] = char( quint8( b[b.size()-1] ) + 1 );
+	return b;
+}
+
+int Idx::scan( const QList<Stream::DataCell>& lo, const QList<Stream::DataCell>& hi, 
+			  Hits& hits, int limit, int opts )
+{
+	checkNull();
+	Database::Lock lock( d_txn->getDb(), false );
+	IndexMeta meta;
+	d_txn->getDb()->getIndexMeta( d_idx, meta );
+	d_key.clear();
+	d_cur.clear();
+	d_match.clear();
+	if( meta.d_kind == IndexMeta::Hash )
+	{
+		d_match = makeHashItems( meta, lo );
+		if( d_match.isEmpty() || d_match != makeHashItems( meta, hi ) )
+			throw DatabaseException( DatabaseException::InvalidArgument, 
+				"hash index supports equality only" );
+		opts &= ~( ExcludeLo | ExcludeHi );
+	}
+	d_lo = makeBound( meta, lo );
+	d_hi = makeBound( meta, hi );
+	d_opts = opts;
+	return fetch( hits, limit, true );
+}
+
+int Idx::scanMore( Hits& hits, int limit )
+{
+	hits.clear();
+	if( d_cur.isEmpty() )
+		return 0;
+	checkNull();
+	Database::Lock lock( d_txn->getDb(), false );
+	return fetch( hits, limit, false );
+}
+
+int Idx::fetch( Hits& hits, int limit, bool first )
+{
+	hits.clear();
+	if( limit > 0 )
+		hits.reserve( limit );
+	const bool rev = d_opts & Reverse;
+	IndexMeta meta;
+	if( !d_match.isEmpty() )
+		d_txn->getDb()->getIndexMeta( d_idx, meta );
+	BtreeCursor cur;
+	cur.open( d_txn->getDb()->getStore(), d_idx );
+	bool ok;
+	if( first && !rev )
+	{
+		if( d_lo.isEmpty() )
+			ok = cur.moveFirst();
+		else
+		{
+			cur.moveTo( d_lo, true );
+			ok = cur.isValidPos();
+		}
+		while( ok && !aboveLo( cur.readKey() ) )
+			ok = cur.moveNext();
+	}else if( first && rev )
+	{
+		const QByteArray end = _prefixEnd( d_hi );
+		if( end.isEmpty() )
+			ok = cur.moveLast();
+		else
+		{
+			cur.moveTo( end, true );
+			ok = ( cur.isValidPos() )?cur.movePrev():cur.moveLast();
+		}
+		while( ok && !belowHi( cur.readKey() ) )
+			ok = cur.movePrev();
+	}else
+	{
+		// Nach dem letzten Treffer weiterfahren; dieser kann inzwischen gelscht sein
+		if( cur.moveTo( d_cur ) )
+			ok = ( rev )?cur.movePrev():cur.moveNext();
+		else if( rev )
+			ok = ( cur.isValidPos() )?cur.movePrev():cur.moveLast();
+		else
+			ok = cur.isValidPos();
+	}
+	d_cur.clear();
+	while( ok )
+	{
+		const QByteArray key = cur.readKey();
+		if( ( rev )?!aboveLo( key ):!belowHi( key ) )
+			break;
+		hits.append( Hit( key ) );
+		hits.last().d_id = readValue( cur.readValue(), 
+			( d_opts & WithValues )?&hits.last().d_values:0 );
+		if( !d_match.isEmpty() && !matchesHash( meta, hits.last().d_id ) )
+			hits.removeLast();
+		if( limit > 0 && hits.size() >= limit )
+		{
+			d_cur = key; // scanMore fhrt hier weiter
+			break;
+		}
+		ok = ( rev )?cur.movePrev():cur.moveNext();
+	}
+	return hits.size();
+}
+
+QByteArray Idx::makeCountKey( int idx, const QByteArray& group )
+{
+	return DataCell().setId32( idx ).writeCell() + group;
+}
+
+QByteArray Idx::bloomKey( const IndexMeta& meta, const QByteArray& key, OID id )
+{
+	if( meta.d_kind == IndexMeta::Hash )
+		return key.left( 8 );
+	return groupOf( meta, key, id );
+}
+
+bool Idx::mayContain( const IndexMeta& meta, const QByteArray& key ) const
+{
+	if( !meta.d_bloom )
+		return true;
+	Bloom* b = d_txn->getDb()->getBloom( d_idx );
+	return b == 0 || b->mayContain( key );
+}
+
+QByteArray Idx::groupOf( const IndexMeta& meta, const QByteArray& key, OID id )
+{
+	if( meta.d_kind != IndexMeta::Value )
+		return key;
+	return key.left( key.size() - DataCell().setId64( id ).writeCell().size() );
+}
+
+quint64 Idx::count( const QList<Stream::DataCell>& lo, const QList<Stream::DataCell>& hi, int opts )
+{
+	quint64 total;
+	aggregate( lo, hi, opts, total, 0 );
+	return total;
+}
+
+quint32 Idx::countDistinct( const QList<Stream::DataCell>& lo, const QList<Stream::DataCell>& hi, 
+						   int opts )
+{
+	quint64 total;
+	return aggregate( lo, hi, opts, total, 0 );
+}
+
+quint32 Idx::groupBy( const QList<Stream::DataCell>& lo, const QList<Stream::DataCell>& hi, 
+					 Groups& groups, int opts )
+{
+	quint64 total;
+	groups.clear();
+	return aggregate( lo, hi, opts, total, &groups );
+}
+
+quint32 Idx::aggregate( const QList<Stream::DataCell>& lo, const QList<Stream::DataCell>& hi, 
+					   int opts, quint64& total, Groups* groups )
+{
+	checkNull();
+	Database::Lock lock( d_txn->getDb(), false );
+	Database* db = d_txn->getDb();
+	IndexMeta meta;
+	if( !db->getIndexMeta( d_idx, meta ) || meta.d_kind == IndexMeta::Fulltext || 
+		meta.d_kind == IndexMeta::Hash || IndexEngine::isPostings( meta ) )
+		throw DatabaseException( DatabaseException::WrongType, "not an ordered index" );
+	const QByteArray loKey = makeBound( meta, lo );
+	const QByteArray hiKey = makeBound( meta, hi );
+	opts &= ( ExcludeLo | ExcludeHi );
+	total = 0;
+	quint32 distinct = 0;
+	BtreeCursor cur;
+	bool ok;
+	if( meta.d_counted )
+	{
+		// Ein Eintrag pro Gruppe: <idx> <items> -> <count> [ <cell> ]*
+		const QByteArray prefix = makeCountKey( d_idx, QByteArray() );
+		cur.open( db->getStore(), db->getCntTable() );
+		cur.moveTo( prefix + loKey, true );
+		ok = cur.isValidPos();
+		while( ok )
+		{
+			const QByteArray key = cur.readKey();
+			if( !key.startsWith( prefix ) )
+				break;
+			const QByteArray group = key.mid( prefix.size() );
+			if( !belowHi( group, hiKey, opts ) )
+				break;
+			if( aboveLo( group, loKey, opts ) )
+			{
+				QByteArray tail;
+				const quint64 n = BtreeBatch::readCount( cur.readValue(), &tail );
+				total += n;
+				distinct++;
+				if( groups )
+				{
+					groups->append( Group( group ) );
+					groups->last().d_count = n;
+					DataReader r( tail );
+					for( DataReader::Token t = r.nextToken(); t == DataReader::Slot; t = r.nextToken() )
+						groups->last().d_values.append( r.readValue() );
+				}
+			}
+			ok = cur.moveNext();
+		}
+		return distinct;
+	}
+	cur.open( db->getStore(), d_idx );
+	if( loKey.isEmpty() )
+		ok = cur.moveFirst();
+	else
+	{
+		cur.moveTo( loKey, true );
+		ok = cur.isValidPos();
+	}
+	QByteArray last;
+	QList<OID> samples; // ein Record pro Gruppe
+	while( ok )
+	{
+		const QByteArray key = cur.readKey();
+		if( !belowHi( key, hiKey, opts ) )
+			break;
+		if( aboveLo( key, loKey, opts ) )
+		{
+			const OID id = readValue( cur.readValue() );
+			const QByteArray group = groupOf( meta, key, id );
+			if( distinct == 0 || group != last )
+			{
+				distinct++;
+				last = group;
+				if( groups )
+				{
+					groups->append( Group( group ) );
+					samples.append( id );
+				}
+			}
+			if( groups )
+				groups->last().d_count++;
+			total++;
+		}
+		ok = cur.moveNext();
+	}
+	// Die Werte aus dem Vertreter lesen, da die kodierten Keys nicht umkehrbar sind
+	for( int g = 0; g < samples.size(); g++ )
+	{
+		Orl o = d_txn->getOrl( samples[g] );
+		for( int i = 0; i < meta.d_items.size(); i++ )
+			(*groups)[g].d_values.append( o.getValue( meta.d_items[i].d_atom ) );
+	}
+	return distinct;
+}
+
+OID Idx::readValue( const QByteArray& value, QList<Stream::DataCell>* values )
+{
+	// <oid> [ <slot> ]*
+	DataCell id;
+	id.readCell( value );
+	const OID oid = id.getId64();
+	if( values )
+	{
+		values->clear();
+		const int len = DataCell().setId64( oid ).writeCell().size();
+		if( value.size() > len )
+		{
+			DataReader r( value.mid( len ) );
+			for( DataReader::Token t = r.nextToken(); t == DataReader::Slot; t = r.nextToken() )
+				values->append( r.readValue() );
+		}
+	}
+	return oid;
+}
+
+bool Idx::getValues( QList<Stream::DataCell>& values )
+{
+	checkNull();
+	Database::Lock lock( d_txn->getDb(), false );
+	values.clear();
+	BtreeCursor cur;
+	cur.open( d_txn->getDb()->getStore(), d_idx );
+	if( !cur.moveTo( d_cur ) )
+		return false;
+	readValue( cur.readValue(), &values );
+	return true;
+}
@@ -20,12 +20,15 @@
 * http://www.gnu.org/copyleft/gpl.html.
 */
 
+#include <QVector>
 #include <Stream/DataCell.h>
 #include <Sdb/Globals.h>
+#include <Sdb/Record.h>
 
 namespace Sdb
 {
 	class Transaction;
+	class BtreeCursor;
 
 	class Idx // Value
 	{
@@ -39,11 +42,54 @@ namespace Sdb
 		bool seek( const Stream::DataCell& key );
 		bool seek( const QList<Stream::DataCell>& keys );
 		bool gotoCur( const QByteArray& );
+		// Bereich lo <= Key <= hi; hi wird als Prfix verglichen. Sinnvoll mit 
+		// IndexMeta::Item::d_ordered fr Zahlen und Datumswerte. Bei d_invert ist lo > hi.
+		bool seekRange( const Stream::DataCell& lo, const Stream::DataCell& hi );
+		bool seekRange( const QList<Stream::DataCell>& lo, const QList<Stream::DataCell>& hi );
+		bool nextInRange(); // false..Ende des Tables oder hi berschritten
+
+		// Liest den Bereich lo..hi mit einem einzigen Abstieg und fllt hits mit hchstens
+		// limit Eintrgen (0..alle). Leere Grenzen sind offen. Rckgabe: Anzahl Eintrge;
+		// scanMore liefert den nchsten Batch, 0..Bereich erschpft.
+		// WithValues..Hit::d_values mit den mitgefhrten Feldern (IndexMeta::d_include) fllen
+		enum ScanOption { Inclusive = 0, ExcludeLo = 1, ExcludeHi = 2, Reverse = 4, WithValues = 8 };
+		struct Hit
+		{
+			QByteArray d_key;
+			OID d_id;
+			QList<Stream::DataCell> d_values;
+			Hit( const QByteArray& key = QByteArray(), OID id = 0 ):d_key(key),d_id(id) {}
+		};
+		typedef QVector<Hit> Hits;
+		int scan( const QList<Stream::DataCell>& lo, const QList<Stream::DataCell>& hi, 
+			Hits&, int limit = 0, int opts = Inclusive );
+		int scanMore( Hits&, int limit = 0 );
+
+		// Aggregate ber den Bereich lo..hi in einem Durchgang. Eine Gruppe umfasst alle 
+		// Eintrge mit gleichen Werten aller Items (bei einem Item also pro Wert). Ist der
+		// Index mit IndexMeta::d_counted erstellt, werden die Zhler statt der Eintrge 
+		// gelesen. Nicht fr Fulltext und Hash.
+		struct Group
+		{
+			QByteArray d_key; // die kodierten Items
+			quint64 d_count;
+			QList<Stream::DataCell> d_values; // die Werte der Items eines Vertreters
+			Group( const QByteArray& key = QByteArray() ):d_key(key),d_count(0) {}
+		};
+		typedef QList<Group> Groups;
+		quint64 count( const QList<Stream::DataCell>& lo, const QList<Stream::DataCell>& hi, 
+			int opts = Inclusive );
+		quint32 countDistinct( const QList<Stream::DataCell>& lo, const QList<Stream::DataCell>& hi, 
+			int opts = Inclusive );
+		quint32 groupBy( const QList<Stream::DataCell>& lo, const QList<Stream::DataCell>& hi, 
+			Groups&, int opts = Inclusive );
 		bool next();
 		bool nextKey();
 		bool prev();
 		bool prevKey();
 		OID getId();
+		// Die mitgefhrten Felder des aktuellen Eintrags in der Reihenfolge von d_include
+		bool getValues( QList<Stream::DataCell>& );
 
 		bool isNull() const { return d_idx == 0; }
 		Transaction* getTxn() const { return d_txn; }
@@ -53,15 +99,57 @@ namespace Sdb
 	protected:
 		void checkNull() const;
 		static void addElement( QByteArray&, const IndexMeta::Item&, const Stream::DataCell& );
-		static void collate( QByteArray&, quint8 collation, const QString& );
+		static bool encodeOrdered( QByteArray&, const Stream::DataCell& ); // false..Typ nicht untersttzt
+		static QByteArray makeBound( const IndexMeta&, const QList<Stream::DataCell>& );
+		bool aboveLo( const QByteArray& ) const;
+		bool belowHi( const QByteArray& ) const;
+		static bool aboveLo( const QByteArray& key, const QByteArray& lo, int opts );
+		static bool belowHi( const QByteArray& key, const QByteArray& hi, int opts );
+		int fetch( Hits&, int limit, bool first );
+		quint32 aggregate( const QList<Stream::DataCell>& lo, const QList<Stream::DataCell>& hi, 
+			int opts, quint64& total, Groups* );
+		static QByteArray makeCountKey( int idx, const QByteArray& group );
+		// Key ohne die nachgestellte Oid eines Value-Index
+		static QByteArray groupOf( const IndexMeta&, const QByteArray& key, OID );
+		// Element des Bloom-Filters zum Key, d.h. was seek mit allen Items sucht
+		static QByteArray bloomKey( const IndexMeta&, const QByteArray& key, OID );
+		bool mayContain( const IndexMeta&, const QByteArray& ) const; // false..sicher nicht
+		static OID readValue( const QByteArray&, QList<Stream::DataCell>* values = 0 );
+		static void collate( QByteArray&, quint8 collation, const QString& ); // Referenz, zeichenweise
+		// Wie collate mit vorgngigem toLower falls nocase, aber tabellengesteuert; hngt an out an
+		static void encode( QByteArray& out, const IndexMeta::Item&, const QString& );
+		static void encode( QByteArray& out, const IndexMeta::Item&, const QByteArray& latin1 );
+		static void invert( QByteArray& );
+		struct Table;
+		static const Table& table();
+		// Key eines Value-, Unique- oder Hash-Index fr den Record, bei Bitmap nur die Items. 
+		// false..ein Item ist null
+		static bool makeKey( const IndexMeta&, OID, const Record::Fields&, QByteArray& key );
+		// Hash-Index: die Items ohne Collation hintereinander, d.h. der Wert vor dem Hashen.
+		// false bzw. leer..ein Item ist null oder fehlt
+		static bool makeHashItems( const IndexMeta&, const Record::Fields&, QByteArray& );
+		static QByteArray makeHashItems( const IndexMeta&, const QList<Stream::DataCell>& );
+		static void addHashElement( QByteArray&, const IndexMeta::Item&, const Stream::DataCell& );
+		static QByteArray makeHash( const QByteArray& items ); // 8 Bytes, big endian
+		bool matchesHash( const IndexMeta&, OID ) const; // Record gegen d_match prfen
+		bool skipMismatch( BtreeCursor&, const IndexMeta& ); // false..kein Treffer mehr
 	private:
 		friend class Transaction;
+		friend class IndexEngine;
+		friend class Query;
+		friend class Bix;
+		friend class Tgx;
+		friend class Database;
 		// NOTE: Hier wrde Database gengen. Da aber alle Txn bentigen, 
 		// wird hier Txn-Pointer gespeichert
 		Transaction* d_txn;
 		int d_idx;
 		QByteArray d_cur;
 		QByteArray d_key;
+		QByteArray d_lo; // Untergrenze von scan
+		QByteArray d_hi; // Obergrenze von seekRange und scan
+		quint8 d_opts; // ScanOption
+		QByteArray d_match; // Hash-Index: die gesuchten Items vor dem Hashen
 	};
 }
 
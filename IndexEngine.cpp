@@ -0,0 +1,695 @@
+/*
+* Copyright 2005-2017 Rochus Keller <mailto:me@rochus-keller.info>
+*
+* This file is part of the DoorScope Sdb library.
+*
+* The following is the license that applies to this copy of the
+* library. For a license to use the library under conditions
+* other than those described here, please email to me@rochus-keller.info.
+*
+* GNU General Public License Usage
+* This file may be used under the terms of the GNU General Public
+* License (GPL) versions 2.0 or 3.0 as published by the Free Software
+* Foundation and appearing in the file LICENSE.GPL included in
+* the packaging of this file. Please review the following information
+* to ensure GNU General Public Licensing requirements will be met:
+* http://www.fsf.org/licensing/licenses/info/GPLv2.html and
+* http://www.gnu.org/copyleft/gpl.html.
+*/
+
+#include "IndexEngine.h"
+#include "Database.h"
+#include "BtreeBatch.h"
+#include "Idx.h"
+#include "RecordImp.h"
+#include "BtreeCursor.h"
+#include "BtreeStore.h"
+#include "Exceptions.h"
+#include "OidSet.h"
+#include <Stream/DataReader.h>
+#include <Stream/DataWriter.h>
+#include <QBuffer>
+#include <QTemporaryFile>
+#include <QDataStream>
+#include <QtConcurrentMap>
+#include <cassert>
+using namespace Sdb;
+using namespace Stream;
+
+static const int s_chunk = 4096; // Anzahl Records, die gemeinsam dekodiert werden
+static const quint32 s_runBudget = 64 * 1024 * 1024; // Bytes pro sortiertem Run
+static const int s_maxTerm = 64; // Bytes, lngere Wrter werden abgeschnitten
+
+static inline Atom _typeOf( const DataCell& v )
+{
+	return ( v.getType() == DataCell::TypeAtom )?v.getAtom():0;
+}
+
+IndexEngine::IndexEngine( Database* db ):d_db(db),d_loaded(false)
+{
+	assert( db != 0 );
+}
+
+void IndexEngine::load()
+{
+	if( d_loaded )
+		return;
+	d_loaded = true;
+	const QList<Index> idx = d_db->getIndexes();
+	for( int i = 0; i < idx.size(); i++ )
+	{
+		Entry e;
+		e.d_idx = idx[i];
+		if( !d_db->getIndexMeta( idx[i], e.d_meta ) || e.d_meta.d_items.isEmpty() )
+			continue;
+		const int n = d_entries.size();
+		d_entries.append( e );
+		foreach( Atom a, atomsOf( e.d_meta ) )
+		{
+			QList<int>& l = d_byAtom[a];
+			if( !l.contains( n ) )
+				l.append( n );
+		}
+	}
+}
+
+QSet<int> IndexEngine::affected( const Record::Fields& f ) const
+{
+	QSet<int> res;
+	Record::Fields::const_iterator j;
+	for( j = f.begin(); j != f.end(); ++j )
+	{
+		QHash<Atom,QList<int> >::const_iterator i = d_byAtom.find( j.key() );
+		if( i != d_byAtom.end() )
+			res += i.value().toSet();
+	}
+	return res;
+}
+
+QSet<Atom> IndexEngine::getAtoms( const Record::Fields& changed )
+{
+	load();
+	QSet<Atom> res;
+	foreach( int i, affected( changed ) )
+		res += atomsOf( d_entries[i].d_meta ).toSet();
+	return res;
+}
+
+bool IndexEngine::accepts( const IndexMeta& meta, const Record::Fields& f )
+{
+	if( !meta.d_types.isEmpty() )
+	{
+		const DataCell& type = f.value( Record::FieldType );
+		if( type.getType() != DataCell::TypeAtom || !meta.d_types.contains( type.getAtom() ) )
+			return false;
+	}
+	for( int i = 0; i < meta.d_required.size(); i++ )
+		if( f.value( meta.d_required[i] ).isNull() )
+			return false;
+	return true;
+}
+
+void IndexEngine::makeKeys( const IndexMeta& meta, OID id, const Record::Fields& f, QSet<QByteArray>& keys )
+{
+	if( !accepts( meta, f ) )
+		return;
+	switch( meta.d_kind )
+	{
+	case IndexMeta::Value:
+	case IndexMeta::Unique:
+	case IndexMeta::Hash:
+		{
+			QByteArray key;
+			if( Idx::makeKey( meta, id, f, key ) )
+				keys.insert( key );
+		}
+		break;
+	case IndexMeta::Bitmap:
+		{
+			QByteArray items;
+			if( Idx::makeKey( meta, id, f, items ) )
+				keys.insert( OidSet::blockKey( items, id ) );
+		}
+		break;
+	case IndexMeta::Trigram:
+		{
+			assert( meta.d_items.size() == 1 );
+			QSet<QByteArray> terms;
+			trigrams( meta.d_items[0], f.value( meta.d_items[0].d_atom ), terms );
+			foreach( const QByteArray& term, terms )
+				keys.insert( OidSet::blockKey( term, id ) );
+		}
+		break;
+	case IndexMeta::Fulltext:
+		{
+			assert( meta.d_items.size() == 1 );
+			QSet<QByteArray> terms;
+			tokenize( meta.d_items[0], f.value( meta.d_items[0].d_atom ), terms );
+			foreach( const QByteArray& term, terms )
+				keys.insert( OidSet::blockKey( term, id ) );
+		}
+		break;
+	}
+}
+
+void IndexEngine::apply( const Entry& e, OID id, const Record::Fields& before, 
+						const Record::Fields& after, BtreeBatch& batch ) const
+{
+	QSet<QByteArray> oldKeys;
+	QSet<QByteArray> newKeys;
+	makeKeys( e.d_meta, id, before, oldKeys );
+	makeKeys( e.d_meta, id, after, newKeys );
+	if( isPostings( e.d_meta ) )
+	{
+		// Posting-Zeilen enthalten Oid-Mengen, es wird nur die eigene Oid gendert
+		foreach( const QByteArray& key, oldKeys )
+		{
+			if( !newKeys.contains( key ) )
+				batch.removeMember( e.d_idx, key, id );
+		}
+		foreach( const QByteArray& key, newKeys )
+		{
+			if( !oldKeys.contains( key ) )
+				batch.addMember( e.d_idx, key, id );
+		}
+		return;
+	}
+	const QByteArray idstr = DataCell().setId64( id ).writeCell();
+	const int cnt = ( e.d_meta.d_counted )?d_db->getCntTable():0;
+	foreach( const QByteArray& key, oldKeys )
+	{
+		if( newKeys.contains( key ) )
+			continue; // unverndert, keine Arbeit im Btree
+		if( cnt )
+			batch.addCount( cnt, Idx::makeCountKey( e.d_idx, Idx::groupOf( e.d_meta, key, id ) ), 
+				-1, QByteArray() );
+		// Bei Unique Index nur die Indizes fr die eigene ID entfernen.
+		if( e.d_meta.d_kind == IndexMeta::Unique )
+			batch.removeIf( e.d_idx, key, idstr );
+		else
+			batch.remove( e.d_idx, key );
+	}
+	// Bei gleichem Key muss der Wert nur neu geschrieben werden, wenn sich mitgefhrte 
+	// Felder gendert haben.
+	const QByteArray newVal = makeValue( e.d_meta, id, after );
+	const bool valChanged = !e.d_meta.d_include.isEmpty() && 
+		makeValue( e.d_meta, id, before ) != newVal;
+	foreach( const QByteArray& key, newKeys )
+	{
+		if( valChanged || !oldKeys.contains( key ) )
+			batch.insert( e.d_idx, key, newVal );
+		if( e.d_meta.d_bloom && !oldKeys.contains( key ) )
+			d_db->addToBloom( e.d_idx, Idx::bloomKey( e.d_meta, key, id ), batch );
+		if( cnt && !oldKeys.contains( key ) )
+			batch.addCount( cnt, Idx::makeCountKey( e.d_idx, Idx::groupOf( e.d_meta, key, id ) ), 
+				1, makeItems( e.d_meta, after ) );
+	}
+}
+
+void IndexEngine::update( OID id, quint8 type, const Record::Fields& before, 
+						 const Record::Fields& changed, BtreeBatch& batch )
+{
+	load();
+	// Typindex der Objekte, sofern mit createTypeIndex angelegt
+	const int typTable = d_db->getTypTable();
+	Record::Fields::const_iterator t = changed.find( Record::FieldType );
+	if( typTable && type == Record::TypeObject && t != changed.end() )
+	{
+		const Atom oldType = _typeOf( before.value( Record::FieldType ) );
+		const Atom newType = _typeOf( t.value() );
+		if( oldType != newType )
+		{
+			if( oldType )
+				batch.remove( typTable, Database::typeKey( oldType, id ) );
+			if( newType )
+				batch.insert( typTable, Database::typeKey( newType, id ), QByteArray() );
+		}
+	}
+	// Adjazenz-Index der Relationen, sofern mit createRelationIndex angelegt
+	const int adjTable = d_db->getAdjTable();
+	if( adjTable && type == Record::TypeRelation && ( changed.contains( Record::FieldSource ) ||
+		changed.contains( Record::FieldTarget ) || changed.contains( Record::FieldType ) ) )
+	{
+		Record::Fields after = before;
+		Record::Fields::const_iterator k;
+		for( k = changed.begin(); k != changed.end(); ++k )
+			after[k.key()] = k.value();
+		const QSet<QByteArray> oldKeys = adjKeys( id, before );
+		const QSet<QByteArray> newKeys = adjKeys( id, after );
+		foreach( const QByteArray& key, oldKeys )
+			if( !newKeys.contains( key ) )
+				batch.remove( adjTable, key );
+		foreach( const QByteArray& key, newKeys )
+			if( !oldKeys.contains( key ) )
+				batch.insert( adjTable, key, QByteArray() );
+	}
+	// Spezialregelung fr Uuids.
+	Record::Fields::const_iterator u = changed.find( Record::FieldUuid );
+	if( u != changed.end() )
+	{
+		const DataCell& old = before.value( Record::FieldUuid );
+		if( old.getType() == DataCell::TypeUuid )
+			d_db->setUuid( 0, old.getUuid(), batch ); // ein insert auf denselben Key hat Vorrang
+		if( u.value().getType() == DataCell::TypeUuid )
+			d_db->setUuid( id, u.value().getUuid(), batch );
+	}
+	foreach( int i, affected( changed ) )
+	{
+		const Entry& e = d_entries[i];
+		// Nur die Items und mitgefhrten Felder des Index werden bentigt
+		Record::Fields oldF;
+		Record::Fields newF;
+		foreach( Atom a, atomsOf( e.d_meta ) )
+		{
+			const DataCell& v = before.value( a );
+			oldF[a] = v;
+			Record::Fields::const_iterator k = changed.find( a );
+			newF[a] = ( k != changed.end() )?k.value():v;
+		}
+		apply( e, id, oldF, newF, batch );
+	}
+}
+
+void IndexEngine::erase( OID id, quint8 type, const Record::Fields& before, BtreeBatch& batch )
+{
+	load();
+	if( d_db->getTypTable() && type == Record::TypeObject && _typeOf( before.value( Record::FieldType ) ) )
+		batch.remove( d_db->getTypTable(), 
+			Database::typeKey( _typeOf( before.value( Record::FieldType ) ), id ) );
+	if( d_db->getAdjTable() && type == Record::TypeRelation )
+		foreach( const QByteArray& key, adjKeys( id, before ) )
+			batch.remove( d_db->getAdjTable(), key );
+	const DataCell& uuid = before.value( Record::FieldUuid );
+	if( uuid.getType() == DataCell::TypeUuid )
+		d_db->setUuid( 0, uuid.getUuid(), batch );
+	const Record::Fields none;
+	foreach( int i, affected( before ) )
+		apply( d_entries[i], id, before, none, batch );
+}
+
+QSet<QByteArray> IndexEngine::adjKeys( OID rid, const Record::Fields& f )
+{
+	QSet<QByteArray> res;
+	const Atom type = _typeOf( f.value( Record::FieldType ) );
+	const OID source = f.value( Record::FieldSource ).toId64();
+	const OID target = f.value( Record::FieldTarget ).toId64();
+	if( source )
+		res.insert( Database::adjKey( source, Database::SourceSide, type, rid ) );
+	if( target )
+		res.insert( Database::adjKey( target, Database::TargetSide, type, rid ) );
+	return res;
+}
+
+bool IndexEngine::isPostings( const IndexMeta& meta )
+{
+	return meta.d_kind == IndexMeta::Fulltext || meta.d_kind == IndexMeta::Bitmap || 
+		meta.d_kind == IndexMeta::Trigram;
+}
+
+QList<Atom> IndexEngine::atomsOf( const IndexMeta& meta )
+{
+	QList<Atom> res;
+	for( int i = 0; i < meta.d_items.size(); i++ )
+		res.append( meta.d_items[i].d_atom );
+	if( !isPostings( meta ) )
+		res += meta.d_include;
+	// Die Felder des Filters, damit eine nderung den Eintrag hinzufgt oder entfernt
+	if( !meta.d_types.isEmpty() && !res.contains( Record::FieldType ) )
+		res.append( Record::FieldType );
+	for( int i = 0; i < meta.d_required.size(); i++ )
+		if( !res.contains( meta.d_required[i] ) )
+			res.append( meta.d_required[i] );
+	return res;
+}
+
+QByteArray IndexEngine::makeItems( const IndexMeta& meta, const Record::Fields& f )
+{
+	DataWriter w;
+	for( int i = 0; i < meta.d_items.size(); i++ )
+		w.writeSlot( f.value( meta.d_items[i].d_atom ) );
+	return w.getStream();
+}
+
+QByteArray IndexEngine::makeValue( const IndexMeta& meta, OID id, const Record::Fields& f )
+{
+	// <oid> [ <slot> ]* ; die Slots enthalten die mitgefhrten Felder in der Reihenfolge
+	// von d_include, fehlende Felder als Null
+	QByteArray res = DataCell().setId64( id ).writeCell();
+	if( meta.d_include.isEmpty() || isPostings( meta ) )
+		return res;
+	DataWriter w;
+	for( int i = 0; i < meta.d_include.size(); i++ )
+		w.writeSlot( f.value( meta.d_include[i] ) );
+	return res + w.getStream();
+}
+
+struct IndexEngine::Job
+{
+	OID d_id;
+	QByteArray d_img;
+	const IndexMeta* d_meta;
+	Database* d_db;
+	QSet<QByteArray> d_keys;
+	QByteArray d_value;
+	QByteArray d_items; // nur bei IndexMeta::d_counted
+	Record::Fields d_fields; // nur gesetzt, wenn ausgelagerte Werte nachgeladen werden mssen
+	bool d_load;
+	Job():d_id(0),d_meta(0),d_db(0),d_load(false) {}
+};
+
+void IndexEngine::decode( Job& j )
+{
+	// Luft in einem Worker-Thread; darf nicht auf den Btree zugreifen.
+	QBuffer buf;
+	buf.buffer() = j.d_db->readImage( j.d_img );
+	j.d_img.clear();
+	buf.open( QIODevice::ReadOnly );
+	RecordImp imp( j.d_db, j.d_id );
+	imp.readFrom( &buf );
+	foreach( Atom a, atomsOf( *j.d_meta ) )
+	{
+		if( imp.d_ool.contains( a ) )
+		{
+			j.d_load = true;
+			j.d_fields = imp.d_fields;
+			return;
+		}
+	}
+	makeKeys( *j.d_meta, j.d_id, imp.d_fields, j.d_keys );
+	j.d_value = makeValue( *j.d_meta, j.d_id, imp.d_fields );
+	if( j.d_meta->d_counted )
+		j.d_items = makeItems( *j.d_meta, imp.d_fields );
+}
+
+typedef QPair<QByteArray,QByteArray> _Entry; // Key, Value
+
+// Schreibt die sortierten Eintrge in den leeren Index-Table. Bei Posting-Listen werden
+// aufeinanderfolgende Eintrge mit gleichem Key zu einer Oid-Menge zusammengefasst.
+struct _Loader
+{
+	BtreeCursor& d_out;
+	bool d_postings;
+	QByteArray d_key;
+	QList<OID> d_set;
+	_Loader( BtreeCursor& out, bool postings ):d_out(out),d_postings(postings) {}
+	void add( const _Entry& e )
+	{
+		if( !d_postings )
+		{
+			d_out.insert( e.first, e.second, true );
+			return;
+		}
+		if( e.first != d_key )
+			finish();
+		d_key = e.first;
+		DataCell id;
+		id.readCell( e.second );
+		OidSet::insert( d_set, id.getId64() );
+	}
+	void finish()
+	{
+		if( !d_set.isEmpty() )
+			d_out.insert( d_key, OidSet::encode( d_set ), true );
+		d_set.clear();
+	}
+};
+
+static void _flushRun( QList<_Entry>& run, QList<QTemporaryFile*>& files )
+{
+	qSort( run );
+	QTemporaryFile* f = new QTemporaryFile();
+	files.append( f );
+	if( !f->open() )
+		throw DatabaseException( DatabaseException::AccessDatabase, "cannot create temporary index run" );
+	QDataStream out( f );
+	for( int i = 0; i < run.size(); i++ )
+		out << run[i].first << run[i].second;
+	f->flush();
+	f->seek( 0 );
+	run.clear();
+}
+
+bool IndexEngine::build( Database* db, Index idx, const IndexMeta& meta, Database::Progress* p )
+{
+	const OID total = db->getMaxOid();
+	QList<_Entry> run;
+	quint32 runSize = 0;
+	QList<QTemporaryFile*> files;
+	QHash<QByteArray,QPair<quint64,QByteArray> > counts; // Gruppe -> Anzahl, Items
+	try
+	{
+		BtreeCursor cur;
+		cur.open( db->getStore(), db->getObjTable(), false );
+		bool more = cur.moveFirst();
+		while( more )
+		{
+			// Block lesen; der Table enthlt neben den Records auch die Uuids
+			QList<Job> jobs;
+			while( more && jobs.size() < s_chunk )
+			{
+				DataCell id;
+				id.readCell( cur.readKey() );
+				if( id.getType() == DataCell::TypeId64 )
+				{
+					Job j;
+					j.d_id = id.getId64();
+					j.d_img = cur.readValue();
+					j.d_meta = &meta;
+					j.d_db = db;
+					jobs.append( j );
+				}
+				more = cur.moveNext();
+			}
+			QtConcurrent::blockingMap( jobs, IndexEngine::decode );
+			for( int i = 0; i < jobs.size(); i++ )
+			{
+				Job& j = jobs[i];
+				if( j.d_load )
+				{
+					foreach( Atom a, atomsOf( meta ) )
+					{
+						if( !j.d_fields.contains( a ) )
+							db->loadValue( j.d_id, a, j.d_fields[a] );
+					}
+					makeKeys( meta, j.d_id, j.d_fields, j.d_keys );
+					j.d_value = makeValue( meta, j.d_id, j.d_fields );
+					if( meta.d_counted )
+						j.d_items = makeItems( meta, j.d_fields );
+				}
+				foreach( const QByteArray& key, j.d_keys )
+				{
+					run.append( _Entry( key, j.d_value ) );
+					runSize += key.size() + j.d_value.size() + 32;
+					if( meta.d_counted )
+					{
+						QPair<quint64,QByteArray>& c = counts[Idx::groupOf( meta, key, j.d_id )];
+						if( c.first++ == 0 )
+							c.second = j.d_items;
+					}
+				}
+			}
+			if( runSize > s_runBudget )
+			{
+				_flushRun( run, files );
+				runSize = 0;
+			}
+			if( p && !jobs.isEmpty() && !p->step( jobs.last().d_id, total ) )
+			{
+				qDeleteAll( files );
+				return false;
+			}
+		}
+
+		// Sortierte Keys anhngen; der Table ist leer, daher sind alle inserts appends
+		BtreeCursor out;
+		out.open( db->getStore(), idx, true );
+		_Loader loader( out, isPostings( meta ) );
+		if( files.isEmpty() )
+		{
+			qSort( run );
+			for( int i = 0; i < run.size(); i++ )
+				loader.add( run[i] );
+		}else
+		{
+			if( !run.isEmpty() )
+				_flushRun( run, files );
+			QList<QDataStream*> in;
+			QMap<_Entry,int> heads; // Key -> Run
+			for( int i = 0; i < files.size(); i++ )
+			{
+				in.append( new QDataStream( files[i] ) );
+				_Entry e;
+				if( !in[i]->atEnd() )
+				{
+					*in[i] >> e.first >> e.second;
+					heads.insert( e, i );
+				}
+			}
+			while( !heads.isEmpty() )
+			{
+				const _Entry e = heads.begin().key();
+				const int i = heads.begin().value();
+				heads.erase( heads.begin() );
+				loader.add( e );
+				if( !in[i]->atEnd() )
+				{
+					_Entry n;
+					*in[i] >> n.first >> n.second;
+					heads.insert( n, i );
+				}
+			}
+			qDeleteAll( in );
+		}
+		loader.finish();
+		if( !counts.isEmpty() )
+		{
+			const int cnt = db->getCntTable();
+			BtreeBatch batch;
+			QHash<QByteArray,QPair<quint64,QByteArray> >::const_iterator i;
+			for( i = counts.begin(); i != counts.end(); ++i )
+				batch.addCount( cnt, Idx::makeCountKey( idx, i.key() ), i.value().first, 
+					i.value().second );
+			batch.apply( db->getStore() );
+		}
+	}catch( ... )
+	{
+		qDeleteAll( files );
+		throw;
+	}
+	qDeleteAll( files );
+	return true;
+}
+
+static void _stripHtml( const QString& in, QString& out )
+{
+	// Tags werden durch Leerzeichen ersetzt, die gngigen Entities aufgelst
+	int i = 0;
+	while( i < in.size() )
+	{
+		const QChar ch = in[i];
+		if( ch == QChar('<') )
+		{
+			const int end = in.indexOf( QChar('>'), i );
+			if( end == -1 )
+				break;
+			out += QChar(' ');
+			i = end + 1;
+		}else if( ch == QChar('&') )
+		{
+			const int end = in.indexOf( QChar(';'), i );
+			if( end == -1 || end - i > 10 )
+			{
+				out += ch;
+				i++;
+				continue;
+			}
+			const QString ent = in.mid( i + 1, end - i - 1 );
+			if( ent.startsWith( QChar('#') ) )
+			{
+				bool ok;
+				const uint code = ( ent.size() > 1 && ent[1].toLower() == QChar('x') )?
+					ent.mid( 2 ).toUInt( &ok, 16 ):ent.mid( 1 ).toUInt( &ok );
+				out += ( ok && code < 0x10000 )?QChar( ushort(code) ):QChar(' ');
+			}else if( ent == "amp" )
+				out += QChar('&');
+			else if( ent == "lt" )
+				out += QChar('<');
+			else if( ent == "gt" )
+				out += QChar('>');
+			else if( ent == "quot" )
+				out += QChar('"');
+			else if( ent == "apos" )
+				out += QChar('\'');
+			else
+				out += QChar(' ');
+			i = end + 1;
+		}else
+		{
+			out += ch;
+			i++;
+		}
+	}
+}
+
+static void _extractText( const DataCell& v, QString& out )
+{
+	switch( v.getType() )
+	{
+	case DataCell::TypeString:
+		out += v.getStr();
+		break;
+	case DataCell::TypeLatin1:
+		out += QString::fromLatin1( v.getArr() );
+		break;
+	case DataCell::TypeAscii:
+		out += QString::fromAscii( v.getArr() );
+		break;
+	case DataCell::TypeHtml:
+		_stripHtml( v.getStr(), out );
+		break;
+	case DataCell::TypeBml:
+		{
+			// Bml ist ein Stream; es werden alle Textwerte darin bercksichtigt
+			DataReader r( v.getArr() );
+			for( DataReader::Token t = r.nextToken(); DataReader::isUseful( t ); t = r.nextToken() )
+			{
+				if( t == DataReader::Slot )
+				{
+					_extractText( r.readValue(), out );
+					out += QChar(' ');
+				}
+			}
+		}
+		break;
+	default:
+		break;
+	}
+}
+
+QByteArray IndexEngine::makeText( const IndexMeta::Item& item, const DataCell& v )
+{
+	QString text;
+	_extractText( v, text );
+	QByteArray res;
+	Idx::encode( res, item, text );
+	return res;
+}
+
+void IndexEngine::trigrams( const IndexMeta::Item& item, const DataCell& v, QSet<QByteArray>& terms )
+{
+	// Ab jeder Position die nchsten drei Bytes; gegen Ende die krzeren Reste, damit auch
+	// Fragmente unter drei Bytes an jeder Position als Prfix eines Terms gefunden werden.
+	const QByteArray text = makeText( item, v );
+	for( int i = 0; i < text.size(); i++ )
+		terms.insert( text.mid( i, 3 ) );
+}
+
+QByteArray IndexEngine::makeTerm( const IndexMeta::Item& item, const QString& word )
+{
+	QByteArray term;
+	Idx::encode( term, item, word );
+	if( term.size() > s_maxTerm )
+		term.truncate( s_maxTerm );
+	return term;
+}
+
+void IndexEngine::tokenize( const IndexMeta::Item& item, const DataCell& v, QSet<QByteArray>& terms )
+{
+	QString text;
+	_extractText( v, text );
+	int start = -1;
+	for( int i = 0; i <= text.size(); i++ )
+	{
+		if( i < text.size() && text[i].isLetterOrNumber() )
+		{
+			if( start == -1 )
+				start = i;
+		}else if( start != -1 )
+		{
+			const QByteArray term = makeTerm( item, text.mid( start, i - start ) );
+			if( !term.isEmpty() )
+				terms.insert( term );
+			start = -1;
+		}
+	}
+}
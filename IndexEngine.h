@@ -0,0 +1,98 @@
+#ifndef __Sdb_IndexEngine__
+#define __Sdb_IndexEngine__
+
+/*
+* Copyright 2005-2017 Rochus Keller <mailto:me@rochus-keller.info>
+*
+* This file is part of the DoorScope Sdb library.
+*
+* The following is the license that applies to this copy of the
+* library. For a license to use the library under conditions
+* other than those described here, please email to me@rochus-keller.info.
+*
+* GNU General Public License Usage
+* This file may be used under the terms of the GNU General Public
+* License (GPL) versions 2.0 or 3.0 as published by the Free Software
+* Foundation and appearing in the file LICENSE.GPL included in
+* the packaging of this file. Please review the following information
+* to ensure GNU General Public Licensing requirements will be met:
+* http://www.fsf.org/licensing/licenses/info/GPLv2.html and
+* http://www.gnu.org/copyleft/gpl.html.
+*/
+
+#include <QHash>
+#include <QSet>
+#include <QList>
+#include <Sdb/Record.h>
+#include <Sdb/Globals.h>
+#include <Sdb/Database.h>
+
+namespace Sdb
+{
+	class Database;
+	class BtreeBatch;
+
+	// Interne Klasse
+	// Wartet die Indizes eines Records inkrementell. Fr jeden betroffenen Index werden die
+	// Keys des alten und des neuen Zustands berechnet und nur deren Differenz in den Batch
+	// geschrieben. Das gilt auch fr Felder, die nicht das erste Item eines kombinierten 
+	// Index sind. Eine Instanz lebt fr einen Commit und liest die IndexMeta nur einmal.
+
+	class IndexEngine
+	{
+	public:
+		IndexEngine( Database* );
+
+		// Alle Atome, deren alter Wert fr update() mit changed bekannt sein muss.
+		QSet<Atom> getAtoms( const Record::Fields& changed );
+		// before..bisheriger Zustand (leer bei neuem Record), changed..genderte Felder
+		// type..Record::Type
+		void update( OID, quint8 type, const Record::Fields& before, const Record::Fields& changed, 
+			BtreeBatch& );
+		// Entfernt alle Index-Eintrge des Records mit Zustand before
+		void erase( OID, quint8 type, const Record::Fields& before, BtreeBatch& );
+
+		// Fllt den leeren Table idx mit den Keys aller bestehenden Records. Die Records 
+		// werden in Blcken gelesen, parallel dekodiert und verschlsselt, die Keys in 
+		// sortierten Runs innerhalb eines Speicherbudgets ausgelagert und am Ende gemischt 
+		// in den Table angehngt. false..durch Progress abgebrochen
+		static bool build( Database*, Index idx, const IndexMeta&, Database::Progress* = 0 );
+		// Erfllt der Record den Filter des Index (IndexMeta::d_types, d_required)
+		static bool accepts( const IndexMeta&, const Record::Fields& );
+		// Alle Keys des Records im Index; leer falls nicht accepts; thread-safe
+		static void makeKeys( const IndexMeta&, OID, const Record::Fields&, QSet<QByteArray>& );
+		// Zerlegt Text aus String, Latin1, Ascii, Html und Bml in normalisierte Wrter
+		static void tokenize( const IndexMeta::Item&, const Stream::DataCell&, QSet<QByteArray>& terms );
+		static QByteArray makeTerm( const IndexMeta::Item&, const QString& word );
+		// Text wie bei tokenize, als Ganzes kodiert (Idx::encode)
+		static QByteArray makeText( const IndexMeta::Item&, const Stream::DataCell& );
+		static void trigrams( const IndexMeta::Item&, const Stream::DataCell&, QSet<QByteArray>& terms );
+		static bool isPostings( const IndexMeta& ); // Werte sind Oid-Mengen (OidSet)
+		// Wert eines Index-Eintrags: Oid und allenfalls die mitgefhrten Felder
+		static QByteArray makeValue( const IndexMeta&, OID, const Record::Fields& );
+		// Die Werte der Items als Slots; Anhang der Zhler (IndexMeta::d_counted)
+		static QByteArray makeItems( const IndexMeta&, const Record::Fields& );
+		static QList<Atom> atomsOf( const IndexMeta& ); // Items, mitgefhrte Felder und Filter
+		// Eintrge der Relation im Adjazenz-Index, siehe Database::adjKey
+		static QSet<QByteArray> adjKeys( OID rid, const Record::Fields& );
+	private:
+		struct Entry
+		{
+			Index d_idx;
+			IndexMeta d_meta;
+		};
+		void load();
+		QSet<int> affected( const Record::Fields& ) const;
+		struct Job;
+		static void decode( Job& );
+		void apply( const Entry&, OID, const Record::Fields& before, 
+			const Record::Fields& after, BtreeBatch& ) const;
+
+		Database* d_db;
+		QList<Entry> d_entries;
+		QHash<Atom,QList<int> > d_byAtom; // Atom -> alle Entries, in denen es vorkommt
+		bool d_loaded;
+	};
+}
+
+#endif
@@ -22,6 +22,7 @@
 #include "Transaction.h"
 #include "Database.h"
 #include "RecordCow.h"
+#include "ElemList.h"
 #include "Exceptions.h"
 #include <QBuffer>
 using namespace Sdb;
@@ -178,6 +179,7 @@ void Lit::erase()
 {
 	checkNull();
 	Database::Lock lock( d_txn->getDb() );
+	ElemList( d_txn, getListOfElem( d_elem ) ).remove( d_elem );
 	Record* replace = removeCurrentFromList();
 	d_txn->erase( d_elem );
 
@@ -232,6 +234,7 @@ void Lit::insertBefore( const Stream::DataCell& v )
 		c.d_id2 = list->getId();
 		d_txn->d_notify.append( c );
 	}
+	ElemList( d_txn, list ).insert( elem, d_elem, true );
 }
 
 void Lit::insertAfter( const Stream::DataCell& v )
@@ -273,6 +276,7 @@ void Lit::insertAfter( const Stream::DataCell& v )
 		c.d_id2 = list->getId();
 		d_txn->d_notify.append( c );
 	}
+	ElemList( d_txn, list ).insert( newElem, d_elem, false );
 }
 
 void Lit::moveBefore( const Lit& target )
@@ -287,8 +291,10 @@ void Lit::moveBefore( const Lit& target )
 		if( d_txn->getIdField( d_elem, Record::FieldNextElem ) == 0 )
 			return; // Trivialfall, keine Operation
 
-		removeCurrentFromList();
 		Record* list = getListOfElem( d_elem );
+		ElemList lst( d_txn, list );
+		lst.remove( d_elem );
+		removeCurrentFromList();
 		Record* oldLast = d_txn->getRecord( 
 			d_txn->getIdField( list, Record::FieldLastElm ), Record::TypeElement );
 		if( oldLast == 0 )
@@ -297,6 +303,7 @@ void Lit::moveBefore( const Lit& target )
 		d_txn->setField( d_elem, Record::FieldPrevElem, DataCell().setId64( oldLast->getId() ) );
 		d_txn->setField( d_elem, Record::FieldNextElem, DataCell().setNull() );
 		d_txn->setField( list, Record::FieldLastElm, DataCell().setId64( d_elem->getId() ) );
+		lst.insert( d_elem, 0, false );
 
 		UpdateInfo c;
 		c.d_kind = UpdateInfo::ElementMoved;
@@ -314,7 +321,10 @@ void Lit::moveBefore( const Lit& target )
 		if( prev == d_elem )
 			return; // Trivialfall, keine Operation
 
+		ElemList lst( d_txn, list );
+		lst.remove( d_elem );
 		removeCurrentFromList();
+		lst.insert( d_elem, next, true );
 		if( prev == 0 )
 		{
 			// Target ist das erste Element in der Liste
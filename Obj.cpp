@@ -22,6 +22,7 @@
 #include "Transaction.h"
 #include "Database.h"
 #include "RecordCow.h"
+#include "ElemList.h"
 #include "Exceptions.h"
 #include <QtDebug>
 using namespace Sdb;
@@ -47,11 +48,13 @@ void Obj::erase()
 {
 	checkNull();
 	Database::Lock lock( d_txn->getDb() );
+	ElemList( d_txn, d_rec ).clear(); // Chunks nicht bei jedem Element nachfhren
 	Lit lit = getFirstElem();
 	if( !lit.isNull() ) do
 	{
 		lit.erase();
 	}while( lit.next() );
+	d_txn->setChunk( d_rec, ElemList::ChildList, QByteArray() ); // dito Kindliste
 	Rel rel = getFirstRel();
 	if( !rel.isNull() ) do
 	{
@@ -98,6 +101,7 @@ Lit Obj::addFirstElem( const Stream::DataCell& v )
 	d_txn->setField( elem, Record::FieldList, DataCell().setOid( d_rec->getId() ) );
 	d_txn->setField( d_rec, Record::FieldFirstElm, DataCell().setId64( elem->getId() ) );
 	d_txn->setField( d_rec, Record::FieldLastElm, DataCell().setId64( elem->getId() ) );
+	ElemList( d_txn, d_rec ).insert( elem, 0, false ); // nur falls die Liste indiziert ist
 
 	UpdateInfo c;
 	c.d_kind = UpdateInfo::ElementAdded;
@@ -162,6 +166,61 @@ Lit Obj::getLastElem() const
 		return Lit( lastElem, d_txn );
 }
 
+quint32 Obj::getElemCount() const
+{
+	if( d_rec == 0 )
+		return 0;
+	Database::Lock lock( d_txn->getDb() );
+	return ElemList( d_txn, d_rec ).getCount();
+}
+
+Lit Obj::getElem( quint32 pos ) const
+{
+	if( d_rec == 0 )
+		return Lit();
+	Database::Lock lock( d_txn->getDb() );
+	Record* elem = d_txn->getRecord( ElemList( d_txn, d_rec ).getAt( pos ), Record::TypeElement );
+	if( elem == 0 )
+		return Lit();
+	else
+		return Lit( elem, d_txn );
+}
+
+Obj::OidList Obj::getElems( quint32 from, quint32 count ) const
+{
+	if( d_rec == 0 )
+		return OidList();
+	Database::Lock lock( d_txn->getDb() );
+	return ElemList( d_txn, d_rec ).getRange( from, count );
+}
+
+quint32 Obj::readElems( quint32 from, quint32 count, ElemValues& out ) const
+{
+	out.clear();
+	if( d_rec == 0 )
+		return 0;
+	Database::Lock lock( d_txn->getDb() );
+	const OidList ids = ElemList( d_txn, d_rec ).getRange( from, count );
+	d_txn->prefetch( ids );
+	out.reserve( ids.size() );
+	for( int i = 0; i < ids.size(); i++ )
+	{
+		Record* elem = d_txn->getRecord( ids[i], Record::TypeElement );
+		if( elem == 0 )
+			throw DatabaseException( DatabaseException::RecordFormat );
+		out.append( ElemValue( ids[i], DataCell() ) );
+		d_txn->getField( elem, Record::FieldValue, out.last().second );
+	}
+	return out.size();
+}
+
+void Obj::indexElems()
+{
+	checkNull();
+	Database::Lock lock( d_txn->getDb() );
+	ElemList( d_txn, d_rec ).build();
+}
+
 Rel Obj::getFirstRel() const
 {
 	if( d_rec == 0 )
@@ -190,6 +249,65 @@ Rel Obj::getLastRel() const
 		return Rel( rel, d_txn );
 }
 
+Obj::OidList Obj::findRels( Atom type, quint8 sides ) const
+{
+	if( d_rec == 0 )
+		return OidList();
+	Database::Lock lock( d_txn->getDb() );
+	if( useRelIndex() )
+		return d_txn->getDb()->findRelations( d_rec->getId(), type, sides );
+	else
+		return walkRels( type, sides, 0xffffffff );
+}
+
+quint32 Obj::countRels( Atom type, quint8 sides ) const
+{
+	if( d_rec == 0 )
+		return 0;
+	Database::Lock lock( d_txn->getDb() );
+	if( useRelIndex() )
+		return d_txn->getDb()->countRelations( d_rec->getId(), type, sides );
+	else
+		return walkRels( type, sides, 0xffffffff ).size();
+}
+
+bool Obj::hasRel( Atom type, quint8 sides ) const
+{
+	if( d_rec == 0 )
+		return false;
+	Database::Lock lock( d_txn->getDb() );
+	if( useRelIndex() )
+		return !d_txn->getDb()->findRelations( d_rec->getId(), type, sides, 1 ).isEmpty();
+	else
+		return !walkRels( type, sides, 1 ).isEmpty();
+}
+
+bool Obj::useRelIndex() const
+{
+	// Der Index zeigt den Stand des letzten Commit; hat die Transaktion die Relationen von
+	// d_rec gendert, gilt die Relationsliste.
+	return d_txn->getDb()->hasRelationIndex() && !d_txn->hasPendingRels( d_rec->getId() );
+}
+
+Obj::OidList Obj::walkRels( Atom type, quint8 sides, quint32 max ) const
+{
+	OidList res;
+	Rel rel = getFirstRel();
+	if( !rel.isNull() ) do
+	{
+		if( rel.getType() != type )
+			continue;
+		if( ( ( sides & Database::SourceSide ) && rel.getSource() == d_rec->getId() ) ||
+			( ( sides & Database::TargetSide ) && rel.getTarget() == d_rec->getId() ) )
+		{
+			res.append( rel.getId() );
+			if( quint32(res.size()) >= max )
+				break;
+		}
+	}while( rel.next( d_rec->getId() ) );
+	return res;
+}
+
 void Obj::dumpElems()
 {
 	checkNull();
@@ -311,6 +429,9 @@ void Obj::deaggregateImp()
 	Record* owner = getOwner().getRec();
 	if( owner == 0 )
 		return;
+	OidList* ids = d_txn->editChildren( owner );
+	if( ids )
+		ids->removeOne( d_rec->getId() );
 	Record* prev = d_txn->getRecord( 
 		d_txn->getIdField( d_rec, Record::FieldPrevObj ), Record::TypeObject );
 	Record* next = d_txn->getRecord( 
@@ -363,6 +484,9 @@ void Obj::aggregateImp(const Obj& owner)
 	d_txn->setField( d_rec, Record::FieldOwner, owner );
 
 	Record* obj = owner.getRec();
+	OidList* ids = d_txn->editChildren( obj );
+	if( ids )
+		ids->append( d_rec->getId() );
 	Record* last = d_txn->getRecord( d_txn->getIdField( obj, Record::FieldLastObj ), 
 		Record::TypeObject );
 	if( last == 0 )
@@ -437,6 +561,14 @@ void Obj::moveBefore( const Obj& target )
 
 		deaggregateImp();
 		d_txn->setField( d_rec, Record::FieldOwner, DataCell().setOid( owner->getId() ) );
+		OidList* ids = d_txn->editChildren( owner );
+		if( ids )
+		{
+			const int pos = ids->indexOf( next->getId() );
+			if( pos < 0 )
+				throw DatabaseException( DatabaseException::RecordFormat );
+			ids->insert( pos, d_rec->getId() );
+		}
 
 		if( prev == 0 )
 		{
@@ -468,6 +600,36 @@ void Obj::moveBefore( const Obj& target )
 	}
 }
 
+Obj::OidList Obj::getObjs() const
+{
+	OidList ids;
+	if( d_rec == 0 )
+		return ids;
+	Database::Lock lock( d_txn->getDb() );
+	if( d_txn->getChildren( d_rec, ids ) )
+		return ids;
+	OID id = d_txn->getIdField( d_rec, Record::FieldFirstObj );
+	while( id != 0 )
+	{
+		ids.append( id );
+		Record* obj = d_txn->getRecord( id, Record::TypeObject );
+		if( obj == 0 )
+			throw DatabaseException( DatabaseException::RecordFormat );
+		id = d_txn->getIdField( obj, Record::FieldNextObj );
+	}
+	return ids;
+}
+
+void Obj::indexObjs( bool on )
+{
+	checkNull();
+	Database::Lock lock( d_txn->getDb() );
+	d_txn->setChunk( d_rec, ElemList::ChildList, QByteArray() );
+	if( on )
+		d_txn->setChunk( d_rec, ElemList::ChildList, 
+			ElemList::writeChildList( getObjs() ) ); // getObjs schreitet nach dem Entfernen die Liste ab
+}
+
 Qit Obj::getFirstSlot() const
 {
 	if( d_rec == 0 )
@@ -26,7 +26,9 @@
 #include <Sdb/Rel.h>
 #include <Sdb/Qit.h>
 #include <Sdb/Mit.h>
+#include <Sdb/Database.h>
 #include <QList>
+#include <QPair>
 
 namespace Sdb
 {
@@ -36,6 +38,8 @@ namespace Sdb
 	public:
 		typedef QList<OID> OidList;
 		typedef QList<Stream::DataCell> KeyList;
+		typedef QPair<OID,Stream::DataCell> ElemValue; // Bookmark, Wert
+		typedef QList<ElemValue> ElemValues;
 
 		Obj( Record* = 0, Transaction* = 0 );
 		Obj( const Obj& );
@@ -54,6 +58,13 @@ namespace Sdb
 		Lit prependElem( const Stream::DataCell& );
 		Lit getFirstElem() const;
 		Lit getLastElem() const;
+		// Positionszugriff ber den Chunk-Index, siehe ElemList; pos ist 0-basiert
+		quint32 getElemCount() const;
+		Lit getElem( quint32 pos ) const; // isNull..ausserhalb der Liste
+		OidList getElems( quint32 from = 0, quint32 count = 0xffffffff ) const; // Bookmarks
+		void indexElems(); // Index aufbauen; ab dann bei jeder nderung der Liste nachgefhrt
+		// Liest count Elemente ab pos from in einem Aufruf ohne Lit; gibt Anzahl gelesene zurck
+		quint32 readElems( quint32 from, quint32 count, ElemValues& out ) const;
 		// - 
 
 		// Objektzugriff als Queue
@@ -80,12 +91,23 @@ namespace Sdb
 		bool next(); // false..kein Nachfolger, unverndert
 		bool prev(); // false..kein Vorgnger, unverngert
 		void moveBefore( const Obj& target = Obj() ); 
+		// Alle Unterobjekte in Reihenfolge, z.B. fr Transaction::prefetch; mit indexObjs()
+		// in einem Lesezugriff, sonst durch Abschreiten der Liste
+		OidList getObjs() const;
+		void indexObjs( bool on = true ); // materialisierte Kindliste ein- bzw. ausschalten
 		// -
 
 		// Relationen
 		Rel relateTo( const Obj& target, Atom type = 0, bool prepend = true );
 		Rel getFirstRel() const;
 		Rel getLastRel() const;
+		// Relationen eines Typs ber den Adjazenz-Index ohne Laden fremder Relationen.
+		// Ohne Database::createRelationIndex, oder wenn die Transaktion die Relationen dieses
+		// Objekts gendert hat, wird stattdessen die Relationsliste abgeschritten; das Resultat
+		// zeigt also immer den Stand der Transaktion. sides siehe Database::RelSide
+		OidList findRels( Atom type, quint8 sides = Database::AnySide ) const; // Rids
+		quint32 countRels( Atom type, quint8 sides = Database::AnySide ) const;
+		bool hasRel( Atom type, quint8 sides = Database::AnySide ) const;
 		// -
 
 		void dumpElems();
@@ -96,6 +118,8 @@ namespace Sdb
 		Lit addFirstElem( const Stream::DataCell& );
 		void aggregateImp(const Obj& owner); // Append
 		void deaggregateImp();
+		OidList walkRels( Atom type, quint8 sides, quint32 max ) const;
+		bool useRelIndex() const;
 	};
 }
 
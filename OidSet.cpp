@@ -0,0 +1,361 @@
+/*
+* Copyright 2005-2017 Rochus Keller <mailto:me@rochus-keller.info>
+*
+* This file is part of the DoorScope Sdb library.
+*
+* The following is the license that applies to this copy of the
+* library. For a license to use the library under conditions
+* other than those described here, please email to me@rochus-keller.info.
+*
+* GNU General Public License Usage
+* This file may be used under the terms of the GNU General Public
+* License (GPL) versions 2.0 or 3.0 as published by the Free Software
+* Foundation and appearing in the file LICENSE.GPL included in
+* the packaging of this file. Please review the following information
+* to ensure GNU General Public Licensing requirements will be met:
+* http://www.fsf.org/licensing/licenses/info/GPLv2.html and
+* http://www.gnu.org/copyleft/gpl.html.
+*/
+
+#include "OidSet.h"
+#include "Exceptions.h"
+#include <QtAlgorithms>
+using namespace Sdb;
+
+QByteArray OidSet::blockKey( const QByteArray& term, OID id )
+{
+	QByteArray key = term;
+	key.reserve( term.size() + 7 );
+	key += char(0);
+	const quint64 block = id >> BlockBits;
+	for( int i = 5; i >= 0; i-- )
+		key += char( ( block >> ( i * 8 ) ) & 0xff );
+	return key;
+}
+
+QByteArray OidSet::termOf( const QByteArray& blockKey )
+{
+	return blockKey.left( blockKey.size() - 7 );
+}
+
+QByteArray OidSet::encode( const QList<OID>& sorted )
+{
+	// Das erste Element absolut, alle weiteren als Differenz zum Vorgnger, je als
+	// Varint mit 7 Bit pro Byte.
+	QByteArray out;
+	if( sorted.size() >= DenseMin && 
+		( sorted.first() >> BlockBits ) == ( sorted.last() >> BlockBits ) )
+	{
+		// <Dense> <Block als 6 Bytes big endian> <BlockWords * 8 Bytes, Bit i fr unteres Oid i>
+		out.fill( 0, 7 + BlockWords * 8 );
+		out[0] = char( Dense );
+		const quint64 block = sorted.first() >> BlockBits;
+		for( int i = 0; i < 6; i++ )
+			out[6 - i] = char( ( block >> ( i * 8 ) ) & 0xff );
+		uchar* p = (uchar*)out.data() + 7;
+		for( int i = 0; i < sorted.size(); i++ )
+		{
+			const quint32 low = sorted[i] & ( ( 1 << BlockBits ) - 1 );
+			p[low >> 3] |= 1 << ( low & 7 );
+		}
+		return out;
+	}
+	out.reserve( sorted.size() * 2 + 8 );
+	out += char( DeltaList );
+	OID last = 0;
+	for( int i = 0; i < sorted.size(); i++ )
+	{
+		quint64 v = sorted[i] - last;
+		last = sorted[i];
+		while( v >= 0x80 )
+		{
+			out += char( ( v & 0x7f ) | 0x80 );
+			v >>= 7;
+		}
+		out += char( v );
+	}
+	return out;
+}
+
+quint32 OidSet::count( const QByteArray& in )
+{
+	if( in.isEmpty() )
+		return 0;
+	quint32 n = 0;
+	if( quint8( in[0] ) == Dense )
+	{
+		// Bits zhlen, ein Nibble pro Schritt
+		static const quint8 bits[16] = { 0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4 };
+		for( int i = 7; i < in.size(); i++ )
+			n += bits[ quint8( in[i] ) & 0xf ] + bits[ quint8( in[i] ) >> 4 ];
+	}else
+	{
+		// Jeder Varint endet mit einem Byte ohne Fortsetzungsbit
+		for( int i = 1; i < in.size(); i++ )
+			if( ( quint8( in[i] ) & 0x80 ) == 0 )
+				n++;
+	}
+	return n;
+}
+
+void OidSet::decode( const QByteArray& in, QList<OID>& sorted )
+{
+	if( in.isEmpty() )
+		return;
+	if( quint8( in[0] ) == Dense )
+	{
+		Bits bits;
+		decode( in, bits );
+		sorted += toList( bits );
+		return;
+	}
+	if( quint8( in[0] ) != DeltaList )
+		throw DatabaseException( DatabaseException::RecordFormat, "unknown posting format" );
+	const char* p = in.constData() + 1;
+	const char* end = in.constData() + in.size();
+	OID last = 0;
+	while( p < end )
+	{
+		quint64 v = 0;
+		int shift = 0;
+		while( p < end && ( quint8(*p) & 0x80 ) )
+		{
+			v |= quint64( quint8(*p) & 0x7f ) << shift;
+			shift += 7;
+			p++;
+		}
+		if( p == end )
+			throw DatabaseException( DatabaseException::RecordFormat, "truncated posting list" );
+		v |= quint64( quint8(*p) ) << shift;
+		p++;
+		last += v;
+		sorted.append( last );
+	}
+}
+
+void OidSet::insert( QList<OID>& sorted, OID id )
+{
+	const int i = lowerBound( sorted, 0, id );
+	if( i == sorted.size() || sorted[i] != id )
+		sorted.insert( i, id );
+}
+
+void OidSet::remove( QList<OID>& sorted, OID id )
+{
+	const int i = lowerBound( sorted, 0, id );
+	if( i < sorted.size() && sorted[i] == id )
+		sorted.removeAt( i );
+}
+
+int OidSet::lowerBound( const QList<OID>& l, int from, OID id )
+{
+	// Galoppierende Suche ab from, danach binr
+	int step = 1;
+	int hi = from;
+	while( hi < l.size() && l[hi] < id )
+	{
+		from = hi + 1;
+		hi += step;
+		step *= 2;
+	}
+	if( hi > l.size() )
+		hi = l.size();
+	while( from < hi )
+	{
+		const int mid = ( from + hi ) / 2;
+		if( l[mid] < id )
+			from = mid + 1;
+		else
+			hi = mid;
+	}
+	return from;
+}
+
+QList<OID> OidSet::intersect( const QList<OID>& a, const QList<OID>& b )
+{
+	// Die krzere Liste bestimmt die Schritte, in der lngeren wird galoppiert
+	const QList<OID>& s = ( a.size() <= b.size() )?a:b;
+	const QList<OID>& l = ( a.size() <= b.size() )?b:a;
+	QList<OID> res;
+	int j = 0;
+	for( int i = 0; i < s.size() && j < l.size(); i++ )
+	{
+		j = lowerBound( l, j, s[i] );
+		if( j < l.size() && l[j] == s[i] )
+			res.append( s[i] );
+	}
+	return res;
+}
+
+QList<OID> OidSet::subtract( const QList<OID>& a, const QList<OID>& b )
+{
+	QList<OID> res;
+	int j = 0;
+	for( int i = 0; i < a.size(); i++ )
+	{
+		j = lowerBound( b, j, a[i] );
+		if( j == b.size() || b[j] != a[i] )
+			res.append( a[i] );
+	}
+	return res;
+}
+
+QVector<quint64>& OidSet::block( Bits& bits, quint64 b )
+{
+	Bits::iterator i = bits.find( b );
+	if( i == bits.end() )
+		i = bits.insert( b, QVector<quint64>( BlockWords, 0 ) );
+	return i.value();
+}
+
+void OidSet::decode( const QByteArray& in, Bits& bits )
+{
+	if( in.isEmpty() )
+		return;
+	if( quint8( in[0] ) == Dense )
+	{
+		if( in.size() != 7 + BlockWords * 8 )
+			throw DatabaseException( DatabaseException::RecordFormat, "truncated posting bitmap" );
+		quint64 b = 0;
+		for( int i = 1; i < 7; i++ )
+			b = ( b << 8 ) | quint8( in[i] );
+		QVector<quint64>& w = block( bits, b );
+		const uchar* p = (const uchar*)in.constData() + 7;
+		for( int i = 0; i < BlockWords; i++ )
+		{
+			quint64 v = 0;
+			for( int j = 7; j >= 0; j-- )
+				v = ( v << 8 ) | p[ i * 8 + j ];
+			w[i] |= v;
+		}
+	}else
+	{
+		QList<OID> l;
+		decode( in, l );
+		toBits( l, bits );
+	}
+}
+
+void OidSet::toBits( const QList<OID>& sorted, Bits& bits )
+{
+	QVector<quint64>* w = 0;
+	quint64 cur = 0;
+	for( int i = 0; i < sorted.size(); i++ )
+	{
+		const quint64 b = sorted[i] >> BlockBits;
+		if( w == 0 || b != cur )
+		{
+			w = &block( bits, b );
+			cur = b;
+		}
+		const quint32 low = sorted[i] & ( ( 1 << BlockBits ) - 1 );
+		(*w)[low >> 6] |= quint64(1) << ( low & 63 );
+	}
+}
+
+QList<OID> OidSet::toList( const Bits& bits )
+{
+	QList<OID> res;
+	Bits::const_iterator i;
+	for( i = bits.begin(); i != bits.end(); ++i )
+	{
+		const OID base = i.key() << BlockBits;
+		const QVector<quint64>& w = i.value();
+		for( int j = 0; j < w.size(); j++ )
+		{
+			quint64 v = w[j];
+			while( v )
+			{
+				int k = 0;
+				while( ( ( v >> k ) & 1 ) == 0 )
+					k++;
+				res.append( base + j * 64 + k );
+				v &= v - 1; // tiefstes Bit lschen
+			}
+		}
+	}
+	return res;
+}
+
+void OidSet::bitAnd( Bits& a, const Bits& b )
+{
+	Bits::iterator i = a.begin();
+	while( i != a.end() )
+	{
+		Bits::const_iterator j = b.find( i.key() );
+		if( j == b.end() )
+		{
+			i = a.erase( i );
+			continue;
+		}
+		quint64* p = i.value().data();
+		const quint64* q = j.value().constData();
+		quint64 any = 0;
+		for( int k = 0; k < BlockWords; k++ )
+			any |= ( p[k] &= q[k] );
+		if( any == 0 )
+			i = a.erase( i );
+		else
+			++i;
+	}
+}
+
+void OidSet::bitOr( Bits& a, const Bits& b )
+{
+	Bits::const_iterator j;
+	for( j = b.begin(); j != b.end(); ++j )
+	{
+		quint64* p = block( a, j.key() ).data();
+		const quint64* q = j.value().constData();
+		for( int k = 0; k < BlockWords; k++ )
+			p[k] |= q[k];
+	}
+}
+
+void OidSet::bitAndNot( Bits& a, const Bits& b )
+{
+	Bits::iterator i = a.begin();
+	while( i != a.end() )
+	{
+		Bits::const_iterator j = b.find( i.key() );
+		if( j == b.end() )
+		{
+			++i;
+			continue;
+		}
+		quint64* p = i.value().data();
+		const quint64* q = j.value().constData();
+		quint64 any = 0;
+		for( int k = 0; k < BlockWords; k++ )
+			any |= ( p[k] &= ~q[k] );
+		if( any == 0 )
+			i = a.erase( i );
+		else
+			++i;
+	}
+}
+
+QList<OID> OidSet::unite( const QList<OID>& a, const QList<OID>& b )
+{
+	QList<OID> res;
+	res.reserve( a.size() + b.size() );
+	int i = 0;
+	int j = 0;
+	while( i < a.size() && j < b.size() )
+	{
+		if( a[i] < b[j] )
+			res.append( a[i++] );
+		else if( b[j] < a[i] )
+			res.append( b[j++] );
+		else
+		{
+			res.append( a[i++] );
+			j++;
+		}
+	}
+	while( i < a.size() )
+		res.append( a[i++] );
+	while( j < b.size() )
+		res.append( b[j++] );
+	return res;
+}
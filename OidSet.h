@@ -0,0 +1,72 @@
+#ifndef __Sdb_OidSet__
+#define __Sdb_OidSet__
+
+/*
+* Copyright 2005-2017 Rochus Keller <mailto:me@rochus-keller.info>
+*
+* This file is part of the DoorScope Sdb library.
+*
+* The following is the license that applies to this copy of the
+* library. For a license to use the library under conditions
+* other than those described here, please email to me@rochus-keller.info.
+*
+* GNU General Public License Usage
+* This file may be used under the terms of the GNU General Public
+* License (GPL) versions 2.0 or 3.0 as published by the Free Software
+* Foundation and appearing in the file LICENSE.GPL included in
+* the packaging of this file. Please review the following information
+* to ensure GNU General Public Licensing requirements will be met:
+* http://www.fsf.org/licensing/licenses/info/GPLv2.html and
+* http://www.gnu.org/copyleft/gpl.html.
+*/
+
+#include <QList>
+#include <QMap>
+#include <QVector>
+#include <QByteArray>
+#include <Sdb/Globals.h>
+
+namespace Sdb
+{
+	// Interne Klasse
+	// Hilfsfunktionen fr aufsteigend sortierte Oid-Listen, wie sie in Posting-Listen
+	// gespeichert und bei Abfragen kombiniert werden.
+
+	class OidSet
+	{
+	public:
+		enum Format { DeltaList = 1, Dense = 2 }; // persistent
+		enum { BlockBits = 16 }; // Oids pro Posting-Zeile: 2^BlockBits
+		enum { BlockWords = ( 1 << BlockBits ) / 64, DenseMin = 4096 }; // ab DenseMin Oids als Bitmap
+
+		// Key einer Posting-Zeile: <term> 0 <oid / 2^BlockBits als 6 Bytes big endian>
+		static QByteArray blockKey( const QByteArray& term, OID );
+		static QByteArray termOf( const QByteArray& blockKey );
+
+		// Liegen alle Oids im selben Block und sind es mindestens DenseMin, wird eine Bitmap
+		// mit einem Bit pro Oid des Blocks geschrieben, sonst eine Differenzliste
+		static QByteArray encode( const QList<OID>& sorted );
+		static void decode( const QByteArray&, QList<OID>& sorted ); // hngt an
+		static quint32 count( const QByteArray& ); // Anzahl Oids ohne Dekodierung
+		static void insert( QList<OID>& sorted, OID );
+		static void remove( QList<OID>& sorted, OID );
+
+		static QList<OID> intersect( const QList<OID>& a, const QList<OID>& b );
+		static QList<OID> unite( const QList<OID>& a, const QList<OID>& b );
+		static QList<OID> subtract( const QList<OID>& a, const QList<OID>& b ); // a ohne b
+
+		// Dichte Darstellung fr wortparallele Verknpfungen: Block -> BlockWords Worte
+		typedef QMap<quint64,QVector<quint64> > Bits;
+		static void decode( const QByteArray&, Bits& ); // vereinigt
+		static void toBits( const QList<OID>& sorted, Bits& ); // vereinigt
+		static QList<OID> toList( const Bits& );
+		static void bitAnd( Bits& a, const Bits& b );
+		static void bitOr( Bits& a, const Bits& b );
+		static void bitAndNot( Bits& a, const Bits& b );
+	private:
+		static QVector<quint64>& block( Bits&, quint64 );
+		static int lowerBound( const QList<OID>&, int from, OID );
+	};
+}
+
+#endif
@@ -0,0 +1,78 @@
+/*
+* Copyright 2005-2017 Rochus Keller <mailto:me@rochus-keller.info>
+*
+* This file is part of the DoorScope Sdb library.
+*
+* The following is the license that applies to this copy of the
+* library. For a license to use the library under conditions
+* other than those described here, please email to me@rochus-keller.info.
+*
+* GNU General Public License Usage
+* This file may be used under the terms of the GNU General Public
+* License (GPL) versions 2.0 or 3.0 as published by the Free Software
+* Foundation and appearing in the file LICENSE.GPL included in
+* the packaging of this file. Please review the following information
+* to ensure GNU General Public Licensing requirements will be met:
+* http://www.fsf.org/licensing/licenses/info/GPLv2.html and
+* http://www.gnu.org/copyleft/gpl.html.
+*/
+
+#include "Oit.h"
+#include "Database.h"
+#include "Exceptions.h"
+#include "BtreeStore.h"
+#include "BtreeCursor.h"
+#include <Stream/DataCell.h>
+#include <QtEndian>
+using namespace Sdb;
+using namespace Stream;
+
+Oit::Oit( Database* db, Atom type ):d_db(db),d_type(type),d_id(0)
+{
+	if( d_db )
+		d_prefix = DataCell().setAtom( d_type ).writeCell();
+}
+
+void Oit::checkNull() const
+{
+	if( d_db == 0 )
+		throw DatabaseException( DatabaseException::AccessDatabase, "null" );
+}
+
+bool Oit::first()
+{
+	return fetch( true );
+}
+
+bool Oit::next()
+{
+	if( d_cur.isEmpty() )
+		return false;
+	return fetch( false );
+}
+
+bool Oit::fetch( bool first )
+{
+	checkNull();
+	Database::Lock lock( d_db, false );
+	BtreeCursor cur;
+	cur.open( d_db->getStore(), d_db->getTypTable() );
+	// d_cur kann inzwischen gelscht sein; moveTo steht dann auf dem nchsten Key
+	cur.moveTo( ( first )?d_prefix:d_cur, true );
+	bool ok = cur.isValidPos();
+	if( ok && !first && cur.readKey() == d_cur )
+		ok = cur.moveNext();
+	if( ok )
+	{
+		const QByteArray key = cur.readKey();
+		if( key.startsWith( d_prefix ) )
+		{
+			d_cur = key;
+			d_id = qFromBigEndian<quint64>( (const uchar*)key.constData() + d_prefix.size() );
+			return true;
+		}
+	}
+	d_cur.clear();
+	d_id = 0;
+	return false;
+}
@@ -0,0 +1,52 @@
+#ifndef __Sdb_Oit__
+#define __Sdb_Oit__
+
+/*
+* Copyright 2005-2017 Rochus Keller <mailto:me@rochus-keller.info>
+*
+* This file is part of the DoorScope Sdb library.
+*
+* The following is the license that applies to this copy of the
+* library. For a license to use the library under conditions
+* other than those described here, please email to me@rochus-keller.info.
+*
+* GNU General Public License Usage
+* This file may be used under the terms of the GNU General Public
+* License (GPL) versions 2.0 or 3.0 as published by the Free Software
+* Foundation and appearing in the file LICENSE.GPL included in
+* the packaging of this file. Please review the following information
+* to ensure GNU General Public Licensing requirements will be met:
+* http://www.fsf.org/licensing/licenses/info/GPLv2.html and
+* http://www.gnu.org/copyleft/gpl.html.
+
+#include <Sdb/Globals.h>
+
+namespace Sdb
+{
+	class Database;
+
+	// Iteriert ber alle Objekte mit gegebenem Record::FieldType in aufsteigender Oid.
+	// Liest den Typindex von Database; hlt keinen Cursor offen.
+	class Oit // Value
+	{
+	public:
+		Oit( Database* = 0, Atom type = 0 );
+
+		bool first();
+		bool next();
+		OID getId() const { return d_id; }
+		Atom getType() const { return d_type; }
+		bool isNull() const { return d_db == 0; }
+	protected:
+		void checkNull() const;
+		bool fetch( bool first );
+	private:
+		Database* d_db;
+		Atom d_type;
+		QByteArray d_prefix;
+		QByteArray d_cur;
+		OID d_id;
+	};
+}
+
+#endif
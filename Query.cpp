@@ -0,0 +1,542 @@
+/*
+* Copyright 2005-2017 Rochus Keller <mailto:me@rochus-keller.info>
+*
+* This file is part of the DoorScope Sdb library.
+*
+* The following is the license that applies to this copy of the
+* library. For a license to use the library under conditions
+* other than those described here, please email to me@rochus-keller.info.
+*
+* GNU General Public License Usage
+* This file may be used under the terms of the GNU General Public
+* License (GPL) versions 2.0 or 3.0 as published by the Free Software
+* Foundation and appearing in the file LICENSE.GPL included in
+* the packaging of this file. Please review the following information
+* to ensure GNU General Public Licensing requirements will be met:
+* http://www.fsf.org/licensing/licenses/info/GPLv2.html and
+* http://www.gnu.org/copyleft/gpl.html.
+*/
+
+#include "Query.h"
+#include "Transaction.h"
+#include "Exceptions.h"
+#include "IndexEngine.h"
+#include "OidSet.h"
+#include "Ftx.h"
+#include "Bix.h"
+#include "Tgx.h"
+#include "Database.h"
+#include "RecordImp.h"
+#include <QtAlgorithms>
+#include <cassert>
+using namespace Sdb;
+using namespace Stream;
+
+static const int s_probe = 1024; // Eintrge, die fr eine Schtzung hchstens gelesen werden
+static const int s_filterFactor = 8; // Prdikat wird am Record geprft, wenn es mehr als
+									 // s_filterFactor mal grsser ist als das Zwischenresultat
+
+Query::Query( Transaction* txn ):d_txn(txn)
+{
+	assert( txn != 0 );
+}
+
+Query::Node Query::add( const Pred& p )
+{
+	d_preds.append( p );
+	return d_preds.size() - 1;
+}
+
+Query::Pred& Query::get( Node n )
+{
+	if( n < 0 || n >= d_preds.size() )
+		throw DatabaseException( DatabaseException::InvalidArgument, "invalid query node" );
+	return d_preds[n];
+}
+
+Query::Node Query::equals( Index idx, const Stream::DataCell& v )
+{
+	return equals( idx, QList<Stream::DataCell>() << v );
+}
+
+Query::Node Query::equals( Index idx, const QList<Stream::DataCell>& key )
+{
+	return range( idx, key, key, Idx::Inclusive );
+}
+
+Query::Node Query::range( Index idx, const QList<Stream::DataCell>& lo, 
+						 const QList<Stream::DataCell>& hi, int opts )
+{
+	Pred p( Range );
+	p.d_idx = idx;
+	if( !d_txn->getDb()->getIndexMeta( idx, p.d_meta ) || p.d_meta.d_kind == IndexMeta::Fulltext || 
+		p.d_meta.d_kind == IndexMeta::Trigram )
+		throw DatabaseException( DatabaseException::WrongType, "not a value index" );
+	p.d_lo = lo;
+	p.d_hi = hi;
+	p.d_opts = opts & ( Idx::ExcludeLo | Idx::ExcludeHi );
+	if( p.d_meta.d_kind == IndexMeta::Hash )
+	{
+		// Am Record werden die ungehashten Items verglichen
+		p.d_loKey = Idx::makeHashItems( p.d_meta, lo );
+		if( p.d_loKey.isEmpty() || p.d_loKey != Idx::makeHashItems( p.d_meta, hi ) )
+			throw DatabaseException( DatabaseException::InvalidArgument, 
+				"hash index supports equality only" );
+		p.d_hiKey = p.d_loKey;
+		p.d_opts = 0;
+		return add( p );
+	}
+	p.d_loKey = Idx::makeBound( p.d_meta, lo );
+	p.d_hiKey = Idx::makeBound( p.d_meta, hi );
+	return add( p );
+}
+
+Query::Node Query::words( Index idx, const QStringList& words, bool all )
+{
+	Pred p( Words );
+	p.d_idx = idx;
+	if( !d_txn->getDb()->getIndexMeta( idx, p.d_meta ) || p.d_meta.d_kind != IndexMeta::Fulltext )
+		throw DatabaseException( DatabaseException::WrongType, "not a fulltext index" );
+	p.d_words = words;
+	p.d_opts = all;
+	return add( p );
+}
+
+Query::Node Query::like( Index idx, const QString& pattern )
+{
+	Pred p( Like );
+	p.d_idx = idx;
+	if( !d_txn->getDb()->getIndexMeta( idx, p.d_meta ) || p.d_meta.d_kind != IndexMeta::Trigram )
+		throw DatabaseException( DatabaseException::WrongType, "not a trigram index" );
+	p.d_words << pattern;
+	return add( p );
+}
+
+Query::Node Query::test( Atom a, const Stream::DataCell& v )
+{
+	Pred p( Test );
+	p.d_atom = a;
+	p.d_value = v;
+	return add( p );
+}
+
+Query::Node Query::all( const QList<Node>& l )
+{
+	Pred p( All );
+	p.d_children = l;
+	return add( p );
+}
+
+Query::Node Query::any( const QList<Node>& l )
+{
+	Pred p( Any );
+	p.d_children = l;
+	return add( p );
+}
+
+Query::Node Query::butNot( Node a, Node b )
+{
+	Pred p( AndNot );
+	p.d_children << a << b;
+	return add( p );
+}
+
+bool Query::isBitmap( Node n )
+{
+	Pred& p = get( n );
+	switch( p.d_kind )
+	{
+	case Range:
+		return p.d_meta.d_kind == IndexMeta::Bitmap;
+	case All:
+	case Any:
+	case AndNot:
+		for( int i = 0; i < p.d_children.size(); i++ )
+			if( !isBitmap( p.d_children[i] ) )
+				return false;
+		return !p.d_children.isEmpty();
+	default:
+		return false;
+	}
+}
+
+void Query::fetchBits( Node n, OidSet::Bits& bits )
+{
+	const Pred p = get( n );
+	switch( p.d_kind )
+	{
+	case Range:
+		Bix( d_txn, p.d_idx ).lookup( p.d_lo, p.d_hi, p.d_opts, bits );
+		break;
+	case Any:
+		for( int i = 0; i < p.d_children.size(); i++ )
+			fetchBits( p.d_children[i], bits );
+		break;
+	case All:
+	case AndNot:
+		{
+			OidSet::Bits res;
+			fetchBits( p.d_children.first(), res );
+			for( int i = 1; i < p.d_children.size() && !res.isEmpty(); i++ )
+			{
+				OidSet::Bits b;
+				fetchBits( p.d_children[i], b );
+				if( p.d_kind == All )
+					OidSet::bitAnd( res, b );
+				else
+					OidSet::bitAndNot( res, b );
+			}
+			OidSet::bitOr( bits, res );
+		}
+		break;
+	default:
+		assert( false );
+	}
+}
+
+bool Query::isIndexed( Node n )
+{
+	Pred& p = get( n );
+	switch( p.d_kind )
+	{
+	case AndNot:
+		return isIndexed( p.d_children.first() );
+	case Range:
+	case Words:
+	case Like:
+		return true;
+	case All:
+		for( int i = 0; i < p.d_children.size(); i++ )
+			if( isIndexed( p.d_children[i] ) )
+				return true;
+		return false;
+	case Any:
+		for( int i = 0; i < p.d_children.size(); i++ )
+			if( !isIndexed( p.d_children[i] ) )
+				return false;
+		return !p.d_children.isEmpty();
+	default:
+		return false;
+	}
+}
+
+quint32 Query::estimate( Node n )
+{
+	if( get( n ).d_est >= 0 )
+		return get( n ).d_est;
+	Database::Lock lock( d_txn->getDb(), false );
+	qint64 est = 0;
+	switch( get( n ).d_kind )
+	{
+	case Range:
+		if( isBitmap( n ) )
+		{
+			// Zeilen zhlen statt dekodieren
+			Pred& p = get( n );
+			est = qMin( qint64( Bix( d_txn, p.d_idx ).count( p.d_lo, p.d_hi, p.d_opts ) ), 
+				qint64( 0xffffffff ) );
+		}else
+		{
+			// Hchstens s_probe Eintrge zhlen; ein voller Probe gilt als gross
+			Pred& p = get( n );
+			Idx idx( d_txn, p.d_idx );
+			Idx::Hits hits;
+			est = idx.scan( p.d_lo, p.d_hi, hits, s_probe, p.d_opts );
+			if( est >= s_probe )
+				est = qint64(s_probe) * s_filterFactor * s_filterFactor;
+		}
+		break;
+	case Words:
+	case Like:
+		est = fetch( n ).size();
+		break;
+	case AndNot:
+		est = estimate( get( n ).d_children.first() );
+		break;
+	case Test:
+		est = 0xffffffff;
+		break;
+	case All:
+		{
+			est = 0xffffffff;
+			const QList<Node> children = get( n ).d_children;
+			for( int i = 0; i < children.size(); i++ )
+				if( isIndexed( children[i] ) )
+					est = qMin( est, qint64( estimate( children[i] ) ) );
+		}
+		break;
+	case Any:
+		{
+			const QList<Node> children = get( n ).d_children;
+			for( int i = 0; i < children.size(); i++ )
+				est = qMin( est + estimate( children[i] ), qint64( 0xffffffff ) );
+		}
+		break;
+	}
+	get( n ).d_est = est;
+	return est;
+}
+
+QList<OID> Query::exec( Node n )
+{
+	Database::Lock lock( d_txn->getDb(), false );
+	if( !isIndexed( n ) )
+		throw DatabaseException( DatabaseException::InvalidArgument, 
+			"query requires at least one indexed predicate" );
+	return fetch( n );
+}
+
+QList<OID> Query::fetch( Node n )
+{
+	if( isBitmap( n ) )
+	{
+		OidSet::Bits bits;
+		fetchBits( n, bits );
+		return OidSet::toList( bits );
+	}
+	const Pred p = get( n );
+	switch( p.d_kind )
+	{
+	case Range:
+		{
+			Idx idx( d_txn, p.d_idx );
+			Idx::Hits hits;
+			idx.scan( p.d_lo, p.d_hi, hits, 0, p.d_opts );
+			QList<OID> res;
+			res.reserve( hits.size() );
+			for( int i = 0; i < hits.size(); i++ )
+				res.append( hits[i].d_id );
+			// Innerhalb eines Werts sind die Oids nicht nach Zahl sortiert, ber mehrere 
+			// Werte ohnehin nicht
+			qSort( res );
+			for( int i = res.size() - 1; i > 0; i-- )
+				if( res[i] == res[i-1] )
+					res.removeAt( i );
+			return res;
+		}
+	case Words:
+	case Like:
+		if( !p.d_fetched )
+		{
+			// Fr Ftx und Tgx gibt es keine billige Schtzung; das Resultat bleibt am Knoten
+			Pred& q = get( n );
+			if( p.d_kind == Words )
+			{
+				Ftx ftx( d_txn, p.d_idx );
+				q.d_hits = ( p.d_opts )?ftx.findAll( p.d_words ):ftx.findAny( p.d_words );
+			}else
+				q.d_hits = Tgx( d_txn, p.d_idx ).like( p.d_words.first() );
+			q.d_fetched = true;
+			return q.d_hits;
+		}
+		return p.d_hits;
+	case Any:
+		{
+			QList<OID> res;
+			for( int i = 0; i < p.d_children.size(); i++ )
+				res = OidSet::unite( res, fetch( p.d_children[i] ) );
+			return res;
+		}
+	case All:
+		{
+			// Indizierte Prdikate nach geschtzter Grsse sortieren, das kleinste treibt.
+			// Die Bitmap-Prdikate werden wortparallel geschnitten und zhlen als ein Prdikat
+			// mit der kleinsten ihrer Schtzungen; Node -1 steht fr diese Gruppe.
+			QList<QPair<quint32,Node> > indexed;
+			QList<Node> tests;
+			QList<Node> bitmaps;
+			for( int i = 0; i < p.d_children.size(); i++ )
+			{
+				if( isBitmap( p.d_children[i] ) )
+					bitmaps.append( p.d_children[i] );
+				else if( isIndexed( p.d_children[i] ) )
+					indexed.append( qMakePair( estimate( p.d_children[i] ), p.d_children[i] ) );
+				else
+					tests.append( p.d_children[i] );
+			}
+			if( !bitmaps.isEmpty() )
+			{
+				quint32 est = 0xffffffff;
+				for( int j = 0; j < bitmaps.size(); j++ )
+					est = qMin( est, estimate( bitmaps[j] ) );
+				indexed.append( qMakePair( est, Node( -1 ) ) );
+			}
+			qSort( indexed );
+			QList<OID> res = fetchAll( indexed.first().second, bitmaps );
+			for( int i = 1; i < indexed.size() && !res.isEmpty(); i++ )
+			{
+				if( indexed[i].first > quint32( res.size() * s_filterFactor ) )
+				{
+					if( indexed[i].second < 0 )
+						tests += bitmaps;
+					else
+						tests.append( indexed[i].second );
+				}else
+					res = OidSet::intersect( res, fetchAll( indexed[i].second, bitmaps ) );
+			}
+			for( int i = 0; i < tests.size() && !res.isEmpty(); i++ )
+				res = filter( res, tests[i] );
+			return res;
+		}
+	case AndNot:
+		{
+			QList<OID> res = fetch( p.d_children[0] );
+			const Node b = p.d_children[1];
+			if( !res.isEmpty() && isIndexed( b ) && 
+				estimate( b ) <= quint32( res.size() * s_filterFactor ) )
+				return OidSet::subtract( res, fetch( b ) );
+			QList<OID> out;
+			for( int i = 0; i < res.size(); i++ )
+				if( !matches( b, res[i] ) )
+					out.append( res[i] );
+			return out;
+		}
+	default:
+		throw DatabaseException( DatabaseException::InvalidArgument, 
+			"predicate cannot be evaluated without a record" );
+	}
+}
+
+QList<OID> Query::fetchAll( Node n, const QList<Node>& bitmaps )
+{
+	if( n >= 0 )
+		return fetch( n );
+	// Die Gruppe der Bitmap-Prdikate eines All
+	OidSet::Bits bits;
+	fetchBits( bitmaps.first(), bits );
+	for( int j = 1; j < bitmaps.size() && !bits.isEmpty(); j++ )
+	{
+		OidSet::Bits b;
+		fetchBits( bitmaps[j], b );
+		OidSet::bitAnd( bits, b );
+	}
+	return OidSet::toList( bits );
+}
+
+QList<OID> Query::filter( const QList<OID>& in, Node n )
+{
+	QList<OID> res;
+	for( int i = 0; i < in.size(); i++ )
+		if( matches( n, in[i] ) )
+			res.append( in[i] );
+	return res;
+}
+
+bool Query::accepts( const IndexMeta& meta, const Record* r )
+{
+	if( meta.d_types.isEmpty() && meta.d_required.isEmpty() )
+		return true;
+	Record::Fields f;
+	foreach( Atom a, IndexEngine::atomsOf( meta ) )
+		f[a] = r->getField( a );
+	return IndexEngine::accepts( meta, f );
+}
+
+bool Query::matches( Node n, OID id )
+{
+	// Wie die Indizes nur den committeten Stand prfen; die nderungen der offenen
+	// Transaktion liegen im COW und bleiben unsichtbar, gleich welcher Plan gewhlt wird.
+	Database::Lock lock( d_txn->getDb(), false );
+	RecordImp* r = d_txn->getDb()->getOrLoadRecord( id );
+	if( r == 0 || r->isNew() )
+		return false;
+	r->addRef();
+	try
+	{
+		const bool res = matches( n, r );
+		r->release();
+		return res;
+	}catch( ... )
+	{
+		r->release();
+		throw;
+	}
+}
+
+bool Query::matches( Node n, const Record* r )
+{
+	const Pred& p = get( n );
+	switch( p.d_kind )
+	{
+	case Range:
+		{
+			// Die Keys des Records wie beim Commit bilden und gegen die Grenzen prfen
+			Record::Fields f;
+			foreach( Atom a, IndexEngine::atomsOf( p.d_meta ) )
+				f[a] = r->getField( a );
+			if( p.d_meta.d_kind == IndexMeta::Hash )
+			{
+				// Wie makeKeys nur Records im Filter eines partiellen Index
+				if( !IndexEngine::accepts( p.d_meta, f ) )
+					return false;
+				QByteArray items;
+				return Idx::makeHashItems( p.d_meta, f, items ) && items == p.d_loKey;
+			}
+			QSet<QByteArray> keys;
+			IndexEngine::makeKeys( p.d_meta, r->getId(), f, keys );
+			foreach( QByteArray key, keys )
+			{
+				if( p.d_meta.d_kind == IndexMeta::Bitmap )
+					key = OidSet::termOf( key );
+				if( Idx::aboveLo( key, p.d_loKey, p.d_opts ) && 
+					Idx::belowHi( key, p.d_hiKey, p.d_opts ) )
+					return true;
+			}
+			return false;
+		}
+	case Words:
+		{
+			if( !accepts( p.d_meta, r ) )
+				return false;
+			const IndexMeta::Item& item = p.d_meta.d_items.first();
+			QSet<QByteArray> terms;
+			IndexEngine::tokenize( item, r->getField( item.d_atom ), terms );
+			int hits = 0;
+			for( int i = 0; i < p.d_words.size(); i++ )
+			{
+				const bool prefix = p.d_words[i].endsWith( QChar('*') );
+				const QByteArray t = IndexEngine::makeTerm( item, 
+					( prefix )?p.d_words[i].left( p.d_words[i].size() - 1 ):p.d_words[i] );
+				bool found = terms.contains( t );
+				if( !found && prefix )
+				{
+					foreach( const QByteArray& term, terms )
+						if( term.startsWith( t ) )
+						{
+							found = true;
+							break;
+						}
+				}
+				if( found )
+					hits++;
+				else if( p.d_opts )
+					return false;
+			}
+			return hits > 0;
+		}
+	case Like:
+		{
+			if( !accepts( p.d_meta, r ) )
+				return false;
+			const IndexMeta::Item& item = p.d_meta.d_items.first();
+			QList<QByteArray> pieces;
+			return Tgx::matches( item, r->getField( item.d_atom ), 
+				Tgx::parse( item, p.d_words.first(), true, pieces ) );
+		}
+	case Test:
+		return r->getField( p.d_atom ).writeCell() == p.d_value.writeCell();
+	case All:
+		for( int i = 0; i < p.d_children.size(); i++ )
+			if( !matches( p.d_children[i], r ) )
+				return false;
+		return true;
+	case Any:
+		for( int i = 0; i < p.d_children.size(); i++ )
+			if( matches( p.d_children[i], r ) )
+				return true;
+		return false;
+	case AndNot:
+		return matches( p.d_children[0], r ) && !matches( p.d_children[1], r );
+	}
+	return false;
+}
@@ -0,0 +1,103 @@
+#ifndef __Sdb_Query__
+#define __Sdb_Query__
+
+/*
+* Copyright 2005-2017 Rochus Keller <mailto:me@rochus-keller.info>
+*
+* This file is part of the DoorScope Sdb library.
+*
+* The following is the license that applies to this copy of the
+* library. For a license to use the library under conditions
+* other than those described here, please email to me@rochus-keller.info.
+*
+* GNU General Public License Usage
+* This file may be used under the terms of the GNU General Public
+* License (GPL) versions 2.0 or 3.0 as published by the Free Software
+* Foundation and appearing in the file LICENSE.GPL included in
+* the packaging of this file. Please review the following information
+* to ensure GNU General Public Licensing requirements will be met:
+* http://www.fsf.org/licensing/licenses/info/GPLv2.html and
+* http://www.gnu.org/copyleft/gpl.html.
+*/
+
+#include <QStringList>
+#include <QList>
+#include <Stream/DataCell.h>
+#include <Sdb/Globals.h>
+#include <Sdb/Idx.h>
+#include <Sdb/OidSet.h>
+
+namespace Sdb
+{
+	class Transaction;
+	class Record;
+
+	// Kombiniert Prdikate ber mehrere Indizes mit AND und OR. Jeder Index liefert eine
+	// sortierte Oid-Liste; diese werden galoppierend geschnitten bzw. vereinigt. Bei AND
+	// bestimmt die geschtzte Treffermenge die Reihenfolge. Ist ein Prdikat im Vergleich
+	// zum Zwischenresultat zu teuer, oder hat es keinen Index, werden stattdessen die 
+	// Records des Zwischenresultats geprft. Prdikate ber Bitmap-Indizes werden wortparallel
+	// verknpft. Die Indizes zeigen den committeten Stand; auch die Prfung einzelner Records
+	// liest diesen, nderungen der offenen Transaktion sind fr Query unsichtbar.
+
+	class Query
+	{
+	public:
+		typedef int Node;
+
+		Query( Transaction* );
+
+		// Bltter
+		Node equals( Index, const Stream::DataCell& );
+		Node equals( Index, const QList<Stream::DataCell>& key ); // Prfix ber die ersten Items
+		Node range( Index, const QList<Stream::DataCell>& lo, const QList<Stream::DataCell>& hi, 
+			int opts = Idx::Inclusive ); // opts: Idx::ExcludeLo, Idx::ExcludeHi
+		Node words( Index fulltext, const QStringList&, bool all = true ); // siehe Ftx
+		Node like( Index trigram, const QString& pattern ); // siehe Tgx
+		Node test( Atom, const Stream::DataCell& ); // ohne Index, nur als Teil von all()
+		// Verknpfungen
+		Node all( const QList<Node>& ); // AND
+		Node any( const QList<Node>& ); // OR
+		Node butNot( Node a, Node b ); // a AND NOT b
+
+		QList<OID> exec( Node ); // aufsteigend sortiert
+		quint32 estimate( Node ); // geschtzte Anzahl Treffer
+		Transaction* getTxn() const { return d_txn; }
+	private:
+		enum Kind { Range, Words, Test, All, Any, AndNot, Like };
+		struct Pred
+		{
+			quint8 d_kind;
+			Index d_idx;
+			IndexMeta d_meta;
+			QList<Stream::DataCell> d_lo;
+			QList<Stream::DataCell> d_hi;
+			QByteArray d_loKey; // kodiert fr den Test am Record
+			QByteArray d_hiKey;
+			quint8 d_opts;
+			QStringList d_words;
+			Atom d_atom;
+			Stream::DataCell d_value;
+			QList<Node> d_children;
+			qint64 d_est; // -1..noch nicht geschtzt
+			QList<OID> d_hits; // Words, Like: von estimate geholt und von fetch wiederverwendet
+			bool d_fetched;
+			Pred( quint8 k = Range ):d_kind(k),d_idx(0),d_opts(0),d_atom(0),d_est(-1),d_fetched(false) {}
+		};
+		Node add( const Pred& );
+		Pred& get( Node );
+		bool isIndexed( Node );
+		QList<OID> fetch( Node );
+		bool isBitmap( Node ); // nur Prdikate ber Bitmap-Indizes
+		void fetchBits( Node, OidSet::Bits& );
+		QList<OID> fetchAll( Node, const QList<Node>& bitmaps ); // -1..Bitmap-Gruppe eines All
+		QList<OID> filter( const QList<OID>&, Node );
+		bool matches( Node, OID ); // committeter Stand
+		bool matches( Node, const Record* );
+		static bool accepts( const IndexMeta&, const Record* ); // Filter eines partiellen Index
+		Transaction* d_txn;
+		QList<Pred> d_preds;
+	};
+}
+
+#endif
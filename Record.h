@@ -59,7 +59,9 @@ namespace Sdb
 			FieldPrevElem, FieldNextElem,
 			// Mixed
 			FieldType, // *Value* Der Typename von Object und Relation als uint32
-			FieldUuid // *Value* Die optionale Uuid von Object und Relation
+			FieldUuid, // *Value* Die optionale Uuid von Object und Relation
+			// Element:
+			FieldChunk // Nummer des Chunks im Positionsindex der Liste, siehe ElemList
 		};
 		Record();
 		virtual ~Record() {}
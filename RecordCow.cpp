@@ -22,7 +22,7 @@
 #include <cassert>
 using namespace Sdb;
 
-RecordCow::RecordCow( RecordImp* cow, Transaction* txn ):d_refCount(0)
+RecordCow::RecordCow( RecordImp* cow, Transaction* txn ):d_refCount(0),d_bufChildren(false),d_elems(0)
 {
 	d_imp = cow;
 	assert( d_imp != 0 );
@@ -33,6 +33,7 @@ RecordCow::RecordCow( RecordImp* cow, Transaction* txn ):d_refCount(0)
 
 RecordCow::~RecordCow()
 {
+	delete d_elems;
 	d_imp->release();
 }
 
@@ -20,7 +20,9 @@
 * http://www.gnu.org/copyleft/gpl.html.
 */
 
+#include <QList>
 #include <Sdb/Record.h>
+#include <Sdb/ElemList.h>
 
 namespace Sdb
 {
@@ -35,6 +37,7 @@ namespace Sdb
 
 		const QMap<quint32,Stream::DataCell>& getQueue() const { return d_queue; }
 		const QMap<QByteArray,Stream::DataCell>& getMap() const { return d_map; }
+		const QMap<quint32,QByteArray>& getChunks() const { return d_chunks; }
 
 		// Overrides
 		const Stream::DataCell& getField( quint32 ) const;
@@ -52,6 +55,10 @@ namespace Sdb
 		Fields d_fields; // Atom:Value
 		QMap<quint32,Stream::DataCell> d_queue;
 		QMap<QByteArray,Stream::DataCell> d_map; // key: BML (vector<cell>)
+		QMap<quint32,QByteArray> d_chunks; // nr -> ElemList-Chunk, 0..Verzeichnis, leer..lschen
+		QList<OID> d_children; // dekodierte Kindliste, wird erst beim Commit kodiert
+		bool d_bufChildren; // true..d_children gilt
+		ElemList::Buffer* d_elems; // 0..Positionsindex der Elemente nicht gepuffert
 	};
 }
 
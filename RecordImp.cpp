@@ -40,7 +40,26 @@ RecordImp::RecordImp(Database* db, OID id, Record::Type t )
 	d_cow = 0;
 }
 
-void RecordImp::writeTo( QIODevice* out ) const
+static bool _isLarge( const DataCell& v, quint32 limit, QByteArray& img )
+{
+	if( limit == 0 )
+		return false;
+	switch( v.getType() )
+	{
+	case DataCell::TypeString:
+	case DataCell::TypeLatin1:
+	case DataCell::TypeAscii:
+	case DataCell::TypeHtml:
+	case DataCell::TypeBml:
+	case DataCell::TypeLob:
+		img = v.writeCell( false, true ); // RISK: compression
+		return quint32(img.size()) > limit;
+	default:
+		return false;
+	}
+}
+
+void RecordImp::writeTo( QIODevice* out, quint32 limit, QMap<Atom,QByteArray>& large ) const
 {
 	assert( out != 0 );
 	DataWriter w( out );
@@ -78,16 +97,42 @@ void RecordImp::writeTo( QIODevice* out ) const
 		break;
 	}
 	w.startFrame();
+	QByteArray img;
 	Record::Fields::const_iterator i;
 	for( i = d_fields.begin(); i != d_fields.end(); ++i )
 	{
 		if( ( i.key() < MinReservedField ||
 			  i.key() == Record::FieldValue ||
 			  i.key() == Record::FieldType ||
-			  i.key() == Record::FieldUuid ) && i.value().hasValue() )
-			w.writeSlot( i.value(), i.key(), true ); // RISK: Komprimiert Speichern
+			  i.key() == Record::FieldUuid ||
+			  i.key() == Record::FieldChunk ) && i.value().hasValue() )
+		{
+			if( i.key() != Record::FieldType && i.key() != Record::FieldUuid &&
+				i.key() != Record::FieldChunk &&
+				_isLarge( i.value(), limit, img ) )
+				large[i.key()] = img;
+			else
+				w.writeSlot( i.value(), i.key(), true ); // RISK: Komprimiert Speichern
+		}
 	}
 	w.endFrame();
+	// Optionaler zweiter Frame mit den Atomen der ausgelagerten Werte. Diese sind entweder
+	// nicht geladen (und unverndert) oder gerade in large gelandet.
+	QSet<Atom> ool;
+	QSet<Atom>::const_iterator j;
+	for( j = d_ool.begin(); j != d_ool.end(); ++j )
+		if( !d_fields.contains( *j ) )
+			ool.insert( *j );
+	QMap<Atom,QByteArray>::const_iterator k;
+	for( k = large.begin(); k != large.end(); ++k )
+		ool.insert( k.key() );
+	if( !ool.isEmpty() )
+	{
+		w.startFrame( NameTag("ool") );
+		for( j = ool.begin(); j != ool.end(); ++j )
+			w.writeSlot( DataCell().setAtom( *j ) );
+		w.endFrame();
+	}
 }
 
 static void _readMb( QIODevice* in, Record::Fields& fields, quint32 a, DataCell::DataType t )
@@ -178,6 +223,22 @@ void RecordImp::readFrom( QIODevice* in )
 	}
 	if( t != DataReader::EndFrame )
 		throw DatabaseException( DatabaseException::RecordFormat );
+	t = r.nextToken();
+	if( t == DataReader::BeginFrame )
+	{
+		// Atome der ausgelagerten Werte
+		t = r.nextToken();
+		while( t == DataReader::Slot )
+		{
+			r.readValue( v );
+			if( v.getType() != DataCell::TypeAtom )
+				throw DatabaseException( DatabaseException::RecordFormat );
+			d_ool.insert( v.getAtom() );
+			t = r.nextToken();
+		}
+		if( t != DataReader::EndFrame )
+			throw DatabaseException( DatabaseException::RecordFormat );
+	}
 }
 
 void RecordImp::clear()
@@ -185,6 +246,7 @@ void RecordImp::clear()
 	d_type = TypeUndefined;
 	d_state = StateIdle;
 	d_fields.clear();
+	d_ool.clear();
 }
 
 const Stream::DataCell& RecordImp::getField( quint32 id ) const
@@ -194,11 +256,29 @@ const Stream::DataCell& RecordImp::getField( quint32 id ) const
 		throw DatabaseException( DatabaseException::RecordDeleted );
 	Record::Fields::const_iterator i = d_fields.find( id );
 	if( i == d_fields.end() )
+	{
+		if( d_ool.contains( id ) )
+			return fetchField( id );
 		return Record::getNull();
-	else
+	}else
 		return i.value();
 }
 
+const Stream::DataCell& RecordImp::fetchField( quint32 id ) const
+{
+	DataCell v;
+	d_db->loadValue( d_id, id, v );
+	return d_fields.insert( id, v ).value();
+}
+
+void RecordImp::fetchAll()
+{
+	QSet<Atom>::const_iterator i;
+	for( i = d_ool.begin(); i != d_ool.end(); ++i )
+		if( !d_fields.contains( *i ) )
+			fetchField( *i );
+}
+
 void RecordImp::addRef() 
 { 
 #if QT_VERSION >= 0x040400
@@ -237,5 +317,9 @@ RecordImp::UsedFields RecordImp::getUsedFields() const
 	for( i = d_fields.begin(); i != d_fields.end(); ++i )
 		if( i.key() < MinReservedField )
 			res.insert( i.key() );
+	QSet<Atom>::const_iterator j;
+	for( j = d_ool.begin(); j != d_ool.end(); ++j )
+		if( *j < MinReservedField )
+			res.insert( *j );
 	return res;
 }
@@ -37,10 +37,12 @@ namespace Sdb
 		Database* getDb() const { return d_db; }
 		int getRefCount() const { return d_refCount; }
 
-		void writeTo( QIODevice* ) const;
+		// Werte grsser als limit werden nicht geschrieben sondern in large zurckgegeben
+		void writeTo( QIODevice*, quint32 limit, QMap<Atom,QByteArray>& large ) const;
 		void readFrom( QIODevice* );
 		void clear();
 		void dump();
+		void fetchAll(); // ldt alle ausgelagerten Werte
 
 		// Overrides
 		const Stream::DataCell& getField( quint32 ) const;
@@ -50,15 +52,21 @@ namespace Sdb
 		void release();
 		UsedFields getUsedFields() const;
 		bool isDeleted() const { return d_state == StateDeleted; }
+		bool isNew() const { return d_state == StateNew; } // noch nicht committet
 	private:
 		friend class Transaction;
+		friend class Database;
+		friend class BulkWriter;
+		friend class IndexEngine;
+		const Stream::DataCell& fetchField( quint32 ) const;
 		quint8 d_type; // Type
 		quint8 d_state;
 		OID d_id; // Eindeutig ber alle Record-Types hinweg
 		Database* d_db;
 		RecordCow* d_cow; // wenn nicht null..lock, Record wird von cow gendert
 		int d_refCount;
-		Fields d_fields; // Atom:Value
+		mutable Fields d_fields; // Atom:Value, ausgelagerte Werte werden bei Bedarf nachgeladen
+		QSet<Atom> d_ool; // Atome der ausgelagerten Werte, geladen oder nicht
 	};
 }
 
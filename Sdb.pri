@@ -1,42 +1,67 @@
 
 HEADERS += \
+    ../Sdb/Bix.h \
+    ../Sdb/Bloom.h \
+    ../Sdb/BtreeBatch.h \
     ../Sdb/BtreeCursor.h \
     ../Sdb/BtreeStore.h \
+    ../Sdb/BulkWriter.h \
     ../Sdb/Database.h \
     ../Sdb/DbStream.h \
+    ../Sdb/ElemList.h \
     ../Sdb/Exceptions.h \
+    ../Sdb/Ftx.h \
     ../Sdb/Globals.h \
     ../Sdb/Idx.h \
+    ../Sdb/IndexEngine.h \
     ../Sdb/Lit.h \
     ../Sdb/MimeMap.h \
     ../Sdb/Mit.h \
     ../Sdb/Obj.h \
+    ../Sdb/OidSet.h \
+    ../Sdb/Oit.h \
     ../Sdb/Orl.h \
     ../Sdb/Private.h \
     ../Sdb/Qit.h \
+    ../Sdb/Query.h \
     ../Sdb/Record.h \
     ../Sdb/RecordCow.h \
     ../Sdb/RecordImp.h \
     ../Sdb/Rel.h \
+    ../Sdb/Tgx.h \
     ../Sdb/Transaction.h \
     ../Sdb/UpdateInfo.h
 
 SOURCES += \
+    ../Sdb/Bix.cpp \
+    ../Sdb/Bloom.cpp \
+    ../Sdb/BtreeBatch.cpp \
     ../Sdb/BtreeCursor.cpp \
     ../Sdb/BtreeStore.cpp \
+    ../Sdb/BulkWriter.cpp \
     ../Sdb/Database.cpp \
     ../Sdb/DbStream.cpp \
+    ../Sdb/ElemList.cpp \
     ../Sdb/Exceptions.cpp \
+    ../Sdb/Ftx.cpp \
     ../Sdb/Idx.cpp \
+    ../Sdb/IndexEngine.cpp \
     ../Sdb/Lit.cpp \
     ../Sdb/MimeMap.cpp \
     ../Sdb/Mit.cpp \
     ../Sdb/Obj.cpp \
+    ../Sdb/OidSet.cpp \
+    ../Sdb/Oit.cpp \
     ../Sdb/Orl.cpp \
     ../Sdb/Qit.cpp \
+    ../Sdb/Query.cpp \
     ../Sdb/Record.cpp \
     ../Sdb/RecordCow.cpp \
     ../Sdb/RecordImp.cpp \
     ../Sdb/Rel.cpp \
+    ../Sdb/Tgx.cpp \
     ../Sdb/Transaction.cpp
 
+# Database verwendet zlib direkt fuer das Woerterbuch der Record-Kompression; Qt bringt zlib mit
+unix: LIBS += -lz
+win32: INCLUDEPATH += $$[QT_INSTALL_PREFIX]/src/3rdparty/zlib
@@ -0,0 +1,239 @@
+/*
+* Copyright 2005-2017 Rochus Keller <mailto:me@rochus-keller.info>
+*
+* This file is part of the DoorScope Sdb library.
+*
+* The following is the license that applies to this copy of the
+* library. For a license to use the library under conditions
+* other than those described here, please email to me@rochus-keller.info.
+*
+* GNU General Public License Usage
+* This file may be used under the terms of the GNU General Public
+* License (GPL) versions 2.0 or 3.0 as published by the Free Software
+* Foundation and appearing in the file LICENSE.GPL included in
+* the packaging of this file. Please review the following information
+* to ensure GNU General Public Licensing requirements will be met:
+* http://www.fsf.org/licensing/licenses/info/GPLv2.html and
+* http://www.gnu.org/copyleft/gpl.html.
+*/
+
+#include <QtTest>
+#include <QDir>
+#include <QUuid>
+#include <Sdb/Database.h>
+#include <Sdb/Transaction.h>
+#include <Sdb/Obj.h>
+#include <Sdb/Lit.h>
+#include <Sdb/ElemList.h>
+#include <Sdb/OidSet.h>
+#include <Sdb/Bloom.h>
+#include <Sdb/Exceptions.h>
+#include <Stream/DataWriter.h>
+using namespace Sdb;
+using namespace Stream;
+
+class SdbTests : public QObject
+{
+	Q_OBJECT
+private slots:
+	void init();
+	void cleanup();
+	void oidSetFormats();
+	void elemListPositions();
+	void bloomNoFalseNegatives();
+	void uuidFilter();
+	void imageRoundTrip();
+private:
+	static QByteArray versionTag( quint8 );
+	void checkPositions( Transaction&, const Obj& );
+	QString d_path;
+	Database* d_db;
+};
+
+void SdbTests::init()
+{
+	d_path = QDir::temp().absoluteFilePath( QString( "SdbTests-%1.db" )
+		.arg( QUuid::createUuid().toString().mid( 1, 8 ) ) );
+	d_db = new Database();
+	d_db->open( d_path );
+}
+
+void SdbTests::cleanup()
+{
+	delete d_db;
+	d_db = 0;
+	QFile::remove( d_path );
+}
+
+QByteArray SdbTests::versionTag( quint8 v )
+{
+	DataWriter w;
+	w.writeSlot( DataCell().setUInt8( v ) );
+	return w.getStream();
+}
+
+void SdbTests::oidSetFormats()
+{
+	// Unter DenseMin eine Differenzliste, ab DenseMin im selben Block eine Bitmap
+	for( int n = OidSet::DenseMin - 1; n <= OidSet::DenseMin; n++ )
+	{
+		QList<OID> ids;
+		for( int i = 0; i < n; i++ )
+			ids.append( 3 * i + 1 );
+		const QByteArray img = OidSet::encode( ids );
+		QCOMPARE( int( quint8( img[0] ) ), 
+			int( ( n < OidSet::DenseMin )?OidSet::DeltaList:OidSet::Dense ) );
+		QList<OID> out;
+		OidSet::decode( img, out );
+		QCOMPARE( out, ids );
+		QCOMPARE( OidSet::count( img ), quint32( n ) );
+		OidSet::Bits bits;
+		OidSet::decode( img, bits );
+		QCOMPARE( OidSet::toList( bits ), ids );
+	}
+	// ber zwei Blcke bleibt es eine Differenzliste
+	QList<OID> ids;
+	for( int i = 0; i < OidSet::DenseMin; i++ )
+		ids.append( OID( i ) << ( OidSet::BlockBits - 11 ) );
+	const QByteArray img = OidSet::encode( ids );
+	QCOMPARE( int( quint8( img[0] ) ), int( OidSet::DeltaList ) );
+	QList<OID> out;
+	OidSet::decode( img, out );
+	QCOMPARE( out, ids );
+}
+
+void SdbTests::checkPositions( Transaction& txn, const Obj& obj )
+{
+	const QList<OID> walked = ElemList( &txn, obj.getRec() ).walk( 0, 0xffffffff );
+	QCOMPARE( obj.getElemCount(), quint32( walked.size() ) );
+	QCOMPARE( obj.getElems(), walked );
+	for( int i = 0; i < walked.size(); i += 97 )
+		QCOMPARE( obj.getElem( i ).getBookmark(), walked[i] );
+	QCOMPARE( obj.getElems( 300, 500 ), walked.mid( 300, 500 ) );
+	QVERIFY( obj.getElem( walked.size() ).isNull() );
+}
+
+void SdbTests::elemListPositions()
+{
+	Transaction txn( d_db );
+	Obj obj = txn.createObject();
+	for( int i = 0; i < 1000; i++ )
+		obj.appendElem( DataCell().setInt32( i ) );
+	QVERIFY( !ElemList( &txn, obj.getRec() ).isIndexed() ); // ohne indexElems bleibt sie einfach
+	obj.indexElems();
+	QVERIFY( ElemList( &txn, obj.getRec() ).isIndexed() );
+	checkPositions( txn, obj );
+
+	// Einfgen in der Mitte teilt volle Chunks
+	for( int i = 0; i < 600; i++ )
+		obj.getElem( 500 ).insertBefore( DataCell().setInt32( -i ) );
+	for( int i = 0; i < 300; i++ )
+		obj.prependElem( DataCell().setInt32( -i ) );
+	checkPositions( txn, obj );
+	txn.commit();
+	checkPositions( txn, obj );
+
+	// Entfernen leert ganze Chunks
+	for( int i = 0; i < 700; i++ )
+		obj.getElem( 250 ).erase();
+	for( int i = 0; i < 100; i++ )
+		obj.getLastElem().erase();
+	checkPositions( txn, obj );
+	txn.commit();
+	checkPositions( txn, obj );
+
+	// Verworfene nderungen lassen den Index unverndert
+	const QList<OID> before = obj.getElems();
+	for( int i = 0; i < 300; i++ )
+		obj.appendElem( DataCell().setInt32( i ) );
+	txn.rollback();
+	QCOMPARE( obj.getElems(), before );
+	checkPositions( txn, obj );
+}
+
+void SdbTests::bloomNoFalseNegatives()
+{
+	const int n = 20000;
+	Bloom b( Bloom::blocksFor( n ) );
+	for( int i = 0; i < n; i++ )
+		b.add( QByteArray::number( i ) );
+	QCOMPARE( b.getCount(), quint64( n ) );
+	QVERIFY( !b.isOverloaded() );
+	int falsePos = 0;
+	for( int i = 0; i < n; i++ )
+	{
+		QVERIFY( b.mayContain( QByteArray::number( i ) ) );
+		if( b.mayContain( QByteArray::number( n + i ) ) )
+			falsePos++;
+	}
+	QVERIFY( falsePos < n / 20 ); // 10 Bits pro Key ergeben rund ein Prozent
+}
+
+void SdbTests::uuidFilter()
+{
+	Transaction txn( d_db );
+	QList<QUuid> uuids;
+	QList<OID> oids;
+	for( int i = 0; i < 500; i++ )
+	{
+		uuids.append( QUuid::createUuid() );
+		oids.append( txn.createObject( uuids.last() ).getOid() );
+	}
+	txn.commit();
+	QVERIFY( !d_db->hasUuidFilter() );
+	d_db->createUuidFilter(); // baut den Filter aus dem Table
+	QVERIFY( d_db->hasUuidFilter() );
+	for( int i = 0; i < 500; i++ )
+	{
+		uuids.append( QUuid::createUuid() );
+		oids.append( txn.createObject( uuids.last() ).getOid() );
+	}
+	txn.commit();
+	for( int i = 0; i < uuids.size(); i++ )
+		QCOMPARE( txn.getObject( uuids[i] ).getOid(), oids[i] );
+	QVERIFY( txn.getObject( QUuid::createUuid() ).isNull() );
+}
+
+void SdbTests::imageRoundTrip()
+{
+	QByteArray img = versionTag( 1 );
+	for( int i = 0; i < 200; i++ )
+		img += "field value " + QByteArray::number( i % 7 );
+
+	// Version 1: unverndert
+	QCOMPARE( d_db->writeImage( img ), img );
+	QCOMPARE( d_db->readImage( img ), img );
+
+	// Version 2: qCompress aus lteren Datenbanken
+	QCOMPARE( d_db->readImage( versionTag( 2 ) + qCompress( img ) ), img );
+
+	// Version 3: zlib mit dem Wrterbuch der Datenbank
+	{
+		Transaction txn( d_db );
+		for( int i = 0; i < 50; i++ )
+			txn.createObject().setValue( d_db->getAtom( "text" ), 
+				DataCell().setString( QString( "some text %1" ).arg( i ) ) );
+		txn.commit();
+	}
+	d_db->setCompression( 64 );
+	const QByteArray zip = d_db->writeImage( img );
+	QVERIFY( zip.startsWith( versionTag( 3 ) ) );
+	QVERIFY( zip.size() < img.size() );
+	QCOMPARE( d_db->readImage( zip ), img );
+
+	// Unplausible Lnge im Kopf
+	QByteArray bad = zip;
+	bad[versionTag( 3 ).size()] = char( 0xff );
+	bool thrown = false;
+	try
+	{
+		d_db->readImage( bad );
+	}catch( const DatabaseException& e )
+	{
+		thrown = e.getCode() == DatabaseException::RecordFormat;
+	}
+	QVERIFY( thrown );
+}
+
+QTEST_MAIN(SdbTests)
+#include "SdbTests.moc"
@@ -0,0 +1,18 @@
+# Kleiner Test der internen Formate und Indizes; erwartet wie in DoorScope Sqlite3
+# und Stream als Nachbarverzeichnisse von Sdb. Sdb.pri ist relativ zu DoorScope
+# formuliert, deshalb hier die Dateien direkt.
+QT += core
+QT -= gui
+CONFIG += qtestlib console
+CONFIG -= app_bundle
+TARGET = SdbTests
+TEMPLATE = app
+
+INCLUDEPATH += ../..
+LIBS += -lz
+
+HEADERS += $$files(../*.h)
+SOURCES += $$files(../*.cpp) \
+	$$files(../../Stream/*.cpp) \
+	$$files(../../Sqlite3/*.c) \
+	SdbTests.cpp
@@ -0,0 +1,176 @@
+/*
+* Copyright 2005-2017 Rochus Keller <mailto:me@rochus-keller.info>
+*
+* This file is part of the DoorScope Sdb library.
+*
+* The following is the license that applies to this copy of the
+* library. For a license to use the library under conditions
+* other than those described here, please email to me@rochus-keller.info.
+*
+* GNU General Public License Usage
+* This file may be used under the terms of the GNU General Public
+* License (GPL) versions 2.0 or 3.0 as published by the Free Software
+* Foundation and appearing in the file LICENSE.GPL included in
+* the packaging of this file. Please review the following information
+* to ensure GNU General Public Licensing requirements will be met:
+* http://www.fsf.org/licensing/licenses/info/GPLv2.html and
+* http://www.gnu.org/copyleft/gpl.html.
+*/
+
+#include "Tgx.h"
+#include "Exceptions.h"
+#include "BtreeCursor.h"
+#include "Transaction.h"
+#include "IndexEngine.h"
+#include "OidSet.h"
+#include "Orl.h"
+#include "Idx.h"
+using namespace Sdb;
+using namespace Stream;
+
+Tgx::Tgx( Transaction* txn, Index idx ):d_txn(txn),d_idx(idx)
+{
+}
+
+void Tgx::checkNull() const
+{
+	if( d_idx == 0 )
+		throw DatabaseException(DatabaseException::AccessRecord, "null");
+}
+
+IndexMeta Tgx::getMeta() const
+{
+	checkNull();
+	IndexMeta meta;
+	if( !d_txn->getDb()->getIndexMeta( d_idx, meta ) || meta.d_kind != IndexMeta::Trigram )
+		throw DatabaseException( DatabaseException::WrongType, "not a trigram index" );
+	return meta;
+}
+
+QRegExp Tgx::parse( const IndexMeta::Item& item, const QString& pattern, bool like, 
+				   QList<QByteArray>& pieces )
+{
+	// Die Stcke werden wie der Text kodiert; der Ausdruck arbeitet auf dem dekodierten 
+	// UTF-8 der Kodierung, damit Collation und Kleinschreibung gleich wirken.
+	QString rx;
+	QString piece;
+	for( int i = 0; i <= pattern.size(); i++ )
+	{
+		const QChar ch = ( i < pattern.size() )?pattern[i]:QChar();
+		if( i == pattern.size() || ( like && ( ch == QChar('%') || ch == QChar('_') ) ) )
+		{
+			if( !piece.isEmpty() )
+			{
+				QByteArray enc;
+				Idx::encode( enc, item, piece );
+				pieces.append( enc );
+				rx += QRegExp::escape( QString::fromUtf8( enc ) );
+				piece.clear();
+			}
+			if( i < pattern.size() )
+				rx += ( ch == QChar('%') )?QLatin1String(".*"):QLatin1String(".");
+		}else
+			piece += ch;
+	}
+	if( like )
+		return QRegExp( QLatin1Char('^') + rx + QLatin1Char('$') );
+	else
+		return QRegExp( rx );
+}
+
+bool Tgx::matches( const IndexMeta::Item& item, const Stream::DataCell& v, const QRegExp& rx )
+{
+	return rx.indexIn( QString::fromUtf8( IndexEngine::makeText( item, v ) ) ) != -1;
+}
+
+QList<OID> Tgx::lookup( const QByteArray& term, bool prefix ) const
+{
+	// Bei Prfixen werden die Listen aller passenden Terms vereinigt
+	const QByteArray key = ( prefix )?term:term + char(0);
+	QList<OID> res;
+	QList<OID> cur;
+	QByteArray last;
+	BtreeCursor c;
+	c.open( d_txn->getDb()->getStore(), d_idx );
+	if( c.moveTo( key, true ) ) do
+	{
+		const QByteArray k = c.readKey();
+		if( !k.startsWith( key ) )
+			break;
+		const QByteArray t = OidSet::termOf( k );
+		if( t != last )
+		{
+			res = OidSet::unite( res, cur );
+			cur.clear();
+			last = t;
+		}
+		OidSet::decode( c.readValue(), cur );
+	}while( c.moveNext() );
+	return OidSet::unite( res, cur );
+}
+
+QList<OID> Tgx::candidates( const QList<QByteArray>& pieces ) const
+{
+	// Jedes Trigramm jedes Stcks muss vorkommen; Stcke unter drei Bytes als Prfix
+	QList<QByteArray> grams;
+	QList<bool> prefix;
+	for( int i = 0; i < pieces.size(); i++ )
+	{
+		const QByteArray& p = pieces[i];
+		if( p.size() < 3 )
+		{
+			grams.append( p );
+			prefix.append( true );
+		}else
+			for( int j = 0; j + 3 <= p.size(); j++ )
+			{
+				if( grams.contains( p.mid( j, 3 ) ) )
+					continue;
+				grams.append( p.mid( j, 3 ) );
+				prefix.append( false );
+			}
+	}
+	if( grams.isEmpty() )
+		throw DatabaseException( DatabaseException::InvalidArgument, 
+			"pattern without text cannot use a trigram index" );
+	QList<OID> res;
+	for( int i = 0; i < grams.size(); i++ )
+	{
+		const QList<OID> l = lookup( grams[i], prefix[i] );
+		res = ( i == 0 )?l:OidSet::intersect( res, l );
+		if( res.isEmpty() )
+			break;
+	}
+	return res;
+}
+
+QList<OID> Tgx::verify( const IndexMeta& meta, const QList<OID>& in, const QRegExp& rx ) const
+{
+	const IndexMeta::Item& item = meta.d_items.first();
+	QList<OID> res;
+	for( int i = 0; i < in.size(); i++ )
+	{
+		Orl o = d_txn->getOrl( in[i] );
+		if( !o.isNull() && matches( item, o.getValue( item.d_atom ), rx ) )
+			res.append( in[i] );
+	}
+	return res;
+}
+
+QList<OID> Tgx::contains( const QString& fragment ) const
+{
+	Database::Lock lock( d_txn->getDb(), false );
+	const IndexMeta meta = getMeta();
+	QList<QByteArray> pieces;
+	const QRegExp rx = parse( meta.d_items.first(), fragment, false, pieces );
+	return verify( meta, candidates( pieces ), rx );
+}
+
+QList<OID> Tgx::like( const QString& pattern ) const
+{
+	Database::Lock lock( d_txn->getDb(), false );
+	const IndexMeta meta = getMeta();
+	QList<QByteArray> pieces;
+	const QRegExp rx = parse( meta.d_items.first(), pattern, true, pieces );
+	return verify( meta, candidates( pieces ), rx );
+}
@@ -0,0 +1,63 @@
+#ifndef __Sdb_Tgx__
+#define __Sdb_Tgx__
+
+/*
+* Copyright 2005-2017 Rochus Keller <mailto:me@rochus-keller.info>
+*
+* This file is part of the DoorScope Sdb library.
+*
+* The following is the license that applies to this copy of the
+* library. For a license to use the library under conditions
+* other than those described here, please email to me@rochus-keller.info.
+*
+* GNU General Public License Usage
+* This file may be used under the terms of the GNU General Public
+* License (GPL) versions 2.0 or 3.0 as published by the Free Software
+* Foundation and appearing in the file LICENSE.GPL included in
+* the packaging of this file. Please review the following information
+* to ensure GNU General Public Licensing requirements will be met:
+* http://www.fsf.org/licensing/licenses/info/GPLv2.html and
+* http://www.gnu.org/copyleft/gpl.html.
+
+#include <QList>
+#include <QRegExp>
+#include <Stream/DataCell.h>
+#include <Sdb/Globals.h>
+
+namespace Sdb
+{
+	class Transaction;
+
+	class Tgx // Trigram
+	{
+	public:
+		Tgx( Transaction* = 0, Index idx = 0 );
+
+		// Der Text wird wie im Index kodiert. Die Kandidaten aus den Trigrammen werden am 
+		// Record geprft. Resultat sind aufsteigende Oids.
+		QList<OID> contains( const QString& fragment ) const;
+		// Muster wie bei SQL LIKE: % beliebig viele, _ genau ein Zeichen
+		QList<OID> like( const QString& pattern ) const;
+
+		bool isNull() const { return d_idx == 0; }
+		Transaction* getTxn() const { return d_txn; }
+		Index getIdx() const { return d_idx; }
+	protected:
+		friend class Query;
+		void checkNull() const;
+		IndexMeta getMeta() const;
+		// Oids, deren Text alle Stcke enthalten knnte
+		QList<OID> candidates( const QList<QByteArray>& pieces ) const;
+		QList<OID> lookup( const QByteArray& term, bool prefix ) const;
+		QList<OID> verify( const IndexMeta&, const QList<OID>&, const QRegExp& ) const;
+		// Zerlegt das Muster in kodierte Stcke ohne Platzhalter und den passenden Ausdruck
+		static QRegExp parse( const IndexMeta::Item&, const QString& pattern, bool like, 
+			QList<QByteArray>& pieces );
+		static bool matches( const IndexMeta::Item&, const Stream::DataCell&, const QRegExp& );
+	private:
+		Transaction* d_txn;
+		Index d_idx;
+	};
+}
+
+#endif
@@ -24,6 +24,9 @@
 #include "RecordImp.h"
 #include "DbStream.h"
 #include "BtreeCursor.h"
+#include "BtreeBatch.h"
+#include "IndexEngine.h"
+#include "ElemList.h"
 #include "Idx.h"
 #include <QList>
 #include <QFile>
@@ -135,6 +138,12 @@ Record* Transaction::getRecord( OID id, Record::Type type ) const
 	return r;
 }
 
+void Transaction::prefetch( const QList<OID>& ids, bool parallel ) const
+{
+	Database::Lock lock( d_db, false );
+	d_db->loadRecords( ids, parallel );
+}
+
 Orl Transaction::getOrl( OID oid ) const
 {
 	Record* r = getRecord( oid, Record::TypeUndefined );
@@ -205,10 +214,8 @@ Rel Transaction::getRelation( const Stream::DataCell& v ) const
 		return Rel();
 }
 
-static void _saveQueue( RecordCow* r, BtreeStore* db, int table )
+static void _saveQueue( RecordCow* r, BtreeBatch& batch, int table )
 {
-	BtreeCursor cur;
-	cur.open( db, table, true );
 	const QByteArray oid = DataCell().setId64( r->getId() ).writeCell();
 
 	QMap<quint32,Stream::DataCell>::const_iterator j;
@@ -216,56 +223,52 @@ static void _saveQueue( RecordCow* r, BtreeStore* db, int table )
 	{
 		const QByteArray nr = DataCell().setId32( j.key() ).writeCell();
 		if( j.value().isNull() )
-		{
-			if( cur.moveTo( oid + nr ) )
-				cur.remove();
-		}else
-		{
-			cur.insert( oid + nr, j.value().writeCell( false, true ) ); // RISK: compression
-		}
+			batch.remove( table, oid + nr );
+		else
+			batch.insert( table, oid + nr, j.value().writeCell( false, true ) ); // RISK: compression
 	}
 }
 
-static void _saveMap( RecordCow* r, BtreeStore* db, int table )
+static void _saveMap( RecordCow* r, BtreeBatch& batch, int table )
 {
-	BtreeCursor cur;
-	cur.open( db, table, true );
 	const QByteArray oid = DataCell().setOid( r->getId() ).writeCell();
 
 	QMap<QByteArray,Stream::DataCell>::const_iterator j;
 	for( j = r->getMap().begin(); j != r->getMap().end(); ++j )
 	{
 		if( j.value().isNull() )
-		{
-			if( cur.moveTo( oid + j.key() ) )
-				cur.remove();
-		}else
-		{
-			cur.insert( oid + j.key(), j.value().writeCell( false, true ) ); // RISK: compression
-		}
+			batch.remove( table, oid + j.key() );
+		else
+			batch.insert( table, oid + j.key(), j.value().writeCell( false, true ) ); // RISK: compression
 	}
 }
 
-static void _eraseQueue( RecordCow* r, BtreeStore* db, int table )
+static void _saveChunks( RecordCow* r, BtreeBatch& batch, int table )
 {
-	BtreeCursor cur;
-	cur.open( db, table, true );
-	const QByteArray oid = DataCell().setId64( r->getId() ).writeCell();
-	if( cur.moveTo( oid, true ) ) do
+	QMap<quint32,QByteArray>::const_iterator j;
+	for( j = r->getChunks().begin(); j != r->getChunks().end(); ++j )
 	{
-		cur.remove();
-	}while( cur.moveNext() && cur.readKey().startsWith( oid ) );
+		const QByteArray key = ElemList::makeKey( r->getId(), j.key() );
+		if( j.value().isEmpty() )
+			batch.remove( table, key );
+		else
+			batch.insert( table, key, j.value() );
+	}
 }
 
-static void _eraseMap( RecordCow* r, BtreeStore* db, int table )
+static void _eraseQueue( RecordCow* r, BtreeBatch& batch, int table )
 {
-	BtreeCursor cur;
-	cur.open( db, table, true );
-	const QByteArray oid = DataCell().setOid( r->getId() ).writeCell();
-	if( cur.moveTo( oid, true ) ) do
-	{
-		cur.remove();
-	}while( cur.moveNext() && cur.readKey().startsWith( oid ) );
+	batch.removePrefix( table, DataCell().setId64( r->getId() ).writeCell() );
+}
+
+static void _eraseMap( RecordCow* r, BtreeBatch& batch, int table )
+{
+	batch.removePrefix( table, DataCell().setOid( r->getId() ).writeCell() );
+}
+
+static void _eraseChunks( RecordCow* r, BtreeBatch& batch, int table )
+{
+	batch.removePrefix( table, DataCell().setOid( r->getId() ).writeCell() );
 }
 
 void Transaction::commit()
@@ -274,6 +277,13 @@ void Transaction::commit()
 		return;
 	d_inTxn = false;
 	Database::Lock lock( d_db, true );
+	// Phase 1: alle Record-Images und Index-nderungen berechnen und im Batch sammeln.
+	// Phase 2: den Batch pro Table in aufsteigender Reihenfolge der Keys schreiben.
+	const int queTable = d_db->getQueTable();
+	const int mapTable = d_db->getMapTable();
+	const int lstTable = d_db->getLstTable();
+	BtreeBatch batch;
+	IndexEngine idx( d_db );
 	QHash<OID,RecordCow*>::const_iterator i;
 	for( i = d_cache.begin(); i != d_cache.end(); ++i )
 	{
@@ -281,14 +291,21 @@ void Transaction::commit()
 		{
 			// Der COW zeigt auf einen IMP
 			i.value()->d_imp->d_cow = 0; // unlock
+			if( i.value()->d_bufChildren )
+				i.value()->d_chunks[ElemList::ChildList] = 
+					ElemList::writeChildList( i.value()->d_children );
+			if( i.value()->d_elems )
+				ElemList::flush( *i.value()->d_elems, i.value()->d_chunks );
 			if( i.value()->d_imp->d_state == RecordImp::StateToDelete )
 			{
 				// Der Record ist zum lschen vorgemerkt. Vollziehe die Lschung
-				removeFromIndex( i.value()->d_imp->d_id, i.value()->d_imp->d_fields,
-					i.value()->d_imp->d_fields );
-				d_db->eraseRecord( i.value()->d_imp );
-				_eraseQueue( i.value(), d_db->getStore(), d_db->getQueTable() );
-				_eraseMap( i.value(), d_db->getStore(), d_db->getMapTable() );
+				i.value()->d_imp->fetchAll();
+				idx.erase( i.value()->d_imp->d_id, i.value()->d_imp->d_type, 
+					i.value()->d_imp->d_fields, batch );
+				d_db->eraseRecord( i.value()->d_imp, batch );
+				_eraseQueue( i.value(), batch, queTable );
+				_eraseMap( i.value(), batch, mapTable );
+				_eraseChunks( i.value(), batch, lstTable );
 				i.value()->d_imp->d_state = RecordImp::StateDeleted;
 			}else if( i.value()->d_imp->d_state == RecordImp::StateNew )
 			{
@@ -296,50 +313,51 @@ void Transaction::commit()
 				// IMP darf daher noch keine Werte enthalten
 				assert( i.value()->d_imp->d_fields.isEmpty() );
 				i.value()->d_imp->d_fields = i.value()->d_fields;
-				addToIndex( i.value()->d_imp->d_id, i.value()->d_imp->d_fields, 
-					i.value()->d_imp->d_fields );
-				d_db->saveRecord( i.value()->d_imp );
-				_saveQueue( i.value(), d_db->getStore(), d_db->getQueTable() );
-				if( !i.value()->getMap().isEmpty() )
-					_saveMap( i.value(), d_db->getStore(), d_db->getMapTable() );
+				idx.update( i.value()->d_imp->d_id, i.value()->d_imp->d_type, Record::Fields(), 
+					i.value()->d_fields, batch );
+				d_db->writeRecord( i.value()->d_imp, 0, batch );
+				_saveQueue( i.value(), batch, queTable );
+				_saveMap( i.value(), batch, mapTable );
+				_saveChunks( i.value(), batch, lstTable );
 				i.value()->d_imp->d_state = RecordImp::StateIdle;
 			}else if( !i.value()->d_fields.isEmpty() )
 			{
-				// Es gab nderungen. bertrage diese in IMP und speichere Record
-				Record::Fields::const_iterator j;
-				for( j = i.value()->d_fields.begin(); j != i.value()->d_fields.end(); ++j )
+				// Es gab nderungen. Zuerst die Index-Differenz aus altem Zustand berechnen,
+				// dann die nderungen in IMP bertragen und Record speichern.
+				foreach( Atom a, idx.getAtoms( i.value()->d_fields ) )
 				{
-					Record::Fields::iterator k = i.value()->d_imp->d_fields.find( j.key() );
-					if( k != i.value()->d_imp->d_fields.end() )
-					{
-						if( !k.value().isNull() )
-							removeFromIndex( i.value()->d_imp->d_id, i.value()->d_imp->d_fields,
-								j.key(), k.value() );
-						k.value() = j.value();
-					}else
-						i.value()->d_imp->d_fields.insert( j.key(), j.value() );
+					if( i.value()->d_imp->d_ool.contains( a ) )
+						i.value()->d_imp->getField( a ); // Alten Wert fr Index nachladen
 				}
-				// TODO: es mssen hier auch nderungen an Feldern in kombinierten Idizes
-				// bercksichtigt werden, die nicht die ersten im Index sind!
-				addToIndex( i.value()->d_imp->d_id, i.value()->d_imp->d_fields, 
-					i.value()->d_fields );
-				d_db->saveRecord( i.value()->d_imp );
-				_saveQueue( i.value(), d_db->getStore(), d_db->getQueTable() );
-				if( !i.value()->getMap().isEmpty() )
-					_saveMap( i.value(), d_db->getStore(), d_db->getMapTable() );
+				idx.update( i.value()->d_imp->d_id, i.value()->d_imp->d_type, i.value()->d_imp->d_fields, 
+					i.value()->d_fields, batch );
+				Record::Fields::const_iterator j;
+				for( j = i.value()->d_fields.begin(); j != i.value()->d_fields.end(); ++j )
+					i.value()->d_imp->d_fields[j.key()] = j.value();
+				d_db->writeRecord( i.value()->d_imp, &i.value()->d_fields, batch );
+				_saveQueue( i.value(), batch, queTable );
+				_saveMap( i.value(), batch, mapTable );
+				_saveChunks( i.value(), batch, lstTable );
 			}else
 			{
-				_saveQueue( i.value(), d_db->getStore(), d_db->getQueTable() );
-				if( !i.value()->getMap().isEmpty() )
-					_saveMap( i.value(), d_db->getStore(), d_db->getMapTable() );
+				_saveQueue( i.value(), batch, queTable );
+				_saveMap( i.value(), batch, mapTable );
+				_saveChunks( i.value(), batch, lstTable );
 			}
 			i.value()->d_fields.clear();
 			i.value()->d_queue.clear();
 			i.value()->d_map.clear();
+			i.value()->d_chunks.clear();
+			i.value()->d_children.clear();
+			i.value()->d_bufChildren = false;
+			delete i.value()->d_elems;
+			i.value()->d_elems = 0;
 		}else
 			// Nur COW, welche auf durch sie gelockten IMP zeigen drfen Daten enthalten
 			assert( i.value()->d_fields.isEmpty() );
 	}
+	batch.apply( d_db->getStore() );
+	d_db->checkBlooms();
 	for( int i = 0; i < d_notify.size(); i++ )
 	{
 		try
@@ -354,148 +372,6 @@ void Transaction::commit()
 	cleanCache();
 }
 
-void Transaction::removeFromIndex( OID id, const Record::Fields& all, const Record::Fields& f )
-{
-	Record::Fields::const_iterator j;
-	for( j = f.begin(); j != f.end(); ++j )
-		removeFromIndex( id, all, j.key(), j.value() );
-}
-
-void Transaction::removeFromIndex(OID id, const Record::Fields& all, quint32 a,const Stream::DataCell& f)
-{
-	if( a == Record::FieldUuid && f.getType() == DataCell::TypeUuid )
-	{
-		// Spezialregelung fr Uuids.
-		d_db->setUuid( 0, f.getUuid() );
-	}
-	const QByteArray idstr = DataCell().setId64( id ).writeCell();
-	QByteArray key;
-	QList<quint32> idx = d_db->findIndexForAtom( a );
-	// Gehe durch alle Indizes, in denen das Atom das erste Element ist
-	for( int i = 0; i < idx.size(); i++ )
-	{
-		key.clear();
-		key.reserve( 255 ); // RISK
-		IndexMeta meta;
-		if( d_db->getIndexMeta( idx[i], meta ) )
-		{
-			if( meta.d_kind == IndexMeta::Fulltext )
-			{
-				assert( meta.d_items.size() == 1 );
-				assert( meta.d_items[0].d_atom == a );
-				if( !f.isNull() )
-				{
-					// TODO: Text in Worte zerlegen, Text aus Html, Xml, Bml extrahieren
-					
-				}
-			}else if( meta.d_kind == IndexMeta::Value ||
-				meta.d_kind == IndexMeta::Unique )
-			{
-				assert( !meta.d_items.isEmpty() );
-				assert( meta.d_items[0].d_atom == a );
-				bool hasNulls = false;
-				if( f.isNull() )
-					hasNulls = true;
-				else
-					Idx::addElement( key, meta.d_items[0], f );
-				for( int j = 1; j < meta.d_items.size() && !hasNulls; j++ )
-				{
-					Record::Fields::const_iterator it = all.find( meta.d_items[j].d_atom );
-					if( it == all.end() || it.value().isNull() )
-					{
-						hasNulls = true;
-					}else
-						Idx::addElement( key, meta.d_items[j], it.value() );
-				}
-				if( !hasNulls )
-				{
-					if( meta.d_kind == IndexMeta::Value )
-						key += idstr;
-					
-					BtreeCursor cur;
-					cur.open( d_db->getStore(), idx[i], true );
-					if( cur.moveTo( key ) )
-					{
-						// Bei Unique Index nur die Indizes fr die eigene ID entfernen.
-						if( meta.d_kind != IndexMeta::Unique || cur.readValue() != idstr )
-							cur.remove();
-					}
-				}
-			}
-		}
-	}
-}
-
-void Transaction::addToIndex(OID id, const Record::Fields& all, quint32 a,const Stream::DataCell& f)
-{
-	if( a == Record::FieldUuid && f.getType() == DataCell::TypeUuid )
-	{
-		// Spezialregelung fr Uuids.
-		d_db->setUuid( id, f.getUuid() );
-	}
-	const QByteArray idstr = DataCell().setId64( id ).writeCell();
-	QByteArray key;
-	QList<quint32> idx = d_db->findIndexForAtom( a );
-	// Gehe durch alle Indizes, in denen das Atom das erste Element ist
-	for( int i = 0; i < idx.size(); i++ )
-	{
-		key.clear();
-		key.reserve( 255 ); // RISK
-		IndexMeta meta;
-		if( d_db->getIndexMeta( idx[i], meta ) )
-		{
-			if( meta.d_kind == IndexMeta::Fulltext )
-			{
-				assert( meta.d_items.size() == 1 );
-				assert( meta.d_items[0].d_atom == a );
-				if( !f.isNull() )
-				{
-					// TODO: Text in Worte zerlegen, Text aus Html, Xml, Bml extrahieren
-					
-				}
-			}else if( meta.d_kind == IndexMeta::Value ||
-				meta.d_kind == IndexMeta::Unique )
-			{
-				assert( !meta.d_items.isEmpty() );
-				assert( meta.d_items[0].d_atom == a );
-				bool hasNulls = false;
-				if( f.isNull() )
-					hasNulls = true;
-				else
-					Idx::addElement( key, meta.d_items[0], f );
-				for( int j = 1; j < meta.d_items.size() && !hasNulls; j++ )
-				{
-					Record::Fields::const_iterator it = all.find( meta.d_items[j].d_atom );
-					if( it == all.end() || it.value().isNull() )
-					{
-						hasNulls = true;
-					}else
-						Idx::addElement( key, meta.d_items[j], it.value() );
-				}
-				if( !hasNulls )
-				{
-					if( meta.d_kind == IndexMeta::Value )
-						key += idstr;
-					
-					BtreeCursor cur;
-					cur.open( d_db->getStore(), idx[i], true );
-					cur.insert( key, idstr );
-				}
-			}
-		}
-	}
-}
-
-void Transaction::addToIndex( OID id, const Record::Fields& all, const Record::Fields& f )
-{
-	// NOTE: in f sind nur die genderten Felder. Da wir fr kombinierte Felder ev.
-	// auch Zugriff auf bestehende, nicht genderte Felder bentigen, muss auch all
-	// mitgeliefert werden!
-	Record::Fields::const_iterator j;
-	for( j = f.begin(); j != f.end(); ++j )
-		addToIndex( id, all, j.key(), j.value() );
-}
-
 void Transaction::rollback()
 {
 	if( !d_inTxn )
@@ -509,6 +385,11 @@ void Transaction::rollback()
 			i.value()->d_fields.clear();
 			i.value()->d_queue.clear();
 			i.value()->d_map.clear();
+			i.value()->d_chunks.clear();
+			i.value()->d_children.clear();
+			i.value()->d_bufChildren = false;
+			delete i.value()->d_elems;
+			i.value()->d_elems = 0;
 			assert( i.value()->d_imp != 0 );
 			if( i.value()->d_imp->d_cow == i.value() )
 			{
@@ -631,6 +512,34 @@ void Transaction::erase( Record* r )
 	rc->d_imp->d_state = RecordImp::StateToDelete;
 }
 
+bool Transaction::hasPendingRels( OID obj ) const
+{
+	// Eine genderte Relation steht (vorher oder nachher) als Source oder Target in der 
+	// Relationsliste von obj; ebenso jede, deren Verkettung beim Einfgen oder Lschen
+	// einer Nachbarin angepasst wurde.
+	Database::Lock lock( d_db, false );
+	QHash<OID,RecordCow*>::const_iterator i;
+	for( i = d_cache.begin(); i != d_cache.end(); ++i )
+	{
+		const RecordCow* rc = i.value();
+		if( rc->d_imp->d_cow != rc )
+			continue;
+		if( rc->d_fields.isEmpty() && rc->d_imp->d_state != RecordImp::StateToDelete )
+			continue;
+		if( rc->getId() == obj && ( rc->d_fields.contains( Record::FieldFirstRel ) || 
+			rc->d_fields.contains( Record::FieldLastRel ) ) )
+			return true;
+		if( rc->d_imp->getType() != Record::TypeRelation )
+			continue;
+		if( rc->getField( Record::FieldSource ).toId64() == obj || 
+			rc->getField( Record::FieldTarget ).toId64() == obj ||
+			rc->d_imp->getField( Record::FieldSource ).toId64() == obj || 
+			rc->d_imp->getField( Record::FieldTarget ).toId64() == obj )
+			return true;
+	}
+	return false;
+}
+
 void Transaction::getField( Record* r,quint32 id, Stream::DataCell& v ) const
 {
 	// Wir mssen den Wert v kopieren, da eine Referenz nicht Threadsicher wre
@@ -786,6 +695,124 @@ void Transaction::setCell( Record* r, const QList<Stream::DataCell>& key, const
 	rc->d_map[_key.getStream()] = v;
 }
 
+void Transaction::getChunk( Record* r, quint32 nr, QByteArray& v ) const
+{
+	v.clear();
+	if( r == 0 )
+		return;
+	Database::Lock lock( d_db, false );
+	RecordCow* rc = dynamic_cast<RecordCow*>( r );
+	if( rc == 0 )
+	{
+		RecordImp* ri = dynamic_cast<RecordImp*>( r );
+		rc = ri->d_cow;
+	}
+	if( rc != 0 )
+	{
+		QMap<quint32,QByteArray>::const_iterator i = rc->d_chunks.find( nr );
+		if( i != rc->d_chunks.end() )
+		{
+			v = i.value();
+			return;
+		}
+	}
+	BtreeCursor cur;
+	cur.open( d_db->getStore(), d_db->getLstTable(), false );
+	if( cur.moveTo( ElemList::makeKey( r->getId(), nr ) ) )
+		v = cur.readValue();
+}
+
+void Transaction::setChunk( Record* r, quint32 nr, const QByteArray& v )
+{
+	d_inTxn = true;
+	RecordCow* rc = lockImp( r );
+	assert( rc->d_imp );
+	assert( rc->d_imp->d_cow = rc );
+	if( rc->d_imp->d_state == RecordImp::StateDeleted )
+		throw DatabaseException( DatabaseException::RecordDeleted );
+	if( nr == ElemList::ChildList )
+	{
+		rc->d_children.clear();
+		rc->d_bufChildren = false;
+	}
+	rc->d_chunks[nr] = v;
+}
+
+bool Transaction::getChildren( Record* r, QList<OID>& ids ) const
+{
+	ids.clear();
+	if( r == 0 )
+		return false;
+	Database::Lock lock( d_db, false );
+	RecordCow* rc = dynamic_cast<RecordCow*>( r );
+	if( rc == 0 )
+	{
+		RecordImp* ri = dynamic_cast<RecordImp*>( r );
+		rc = ri->d_cow;
+	}
+	if( rc != 0 && rc->d_bufChildren )
+	{
+		ids = rc->d_children;
+		return true;
+	}
+	QByteArray img;
+	getChunk( r, ElemList::ChildList, img );
+	return ElemList::readChildList( img, ids );
+}
+
+const ElemList::Buffer* Transaction::peekElems( Record* r ) const
+{
+	if( r == 0 )
+		return 0;
+	RecordCow* rc = dynamic_cast<RecordCow*>( r );
+	if( rc == 0 )
+	{
+		RecordImp* ri = dynamic_cast<RecordImp*>( r );
+		rc = ri->d_cow;
+	}
+	if( rc == 0 )
+		return 0;
+	return rc->d_elems;
+}
+
+ElemList::Buffer* Transaction::editElems( Record* r )
+{
+	d_inTxn = true;
+	RecordCow* rc = lockImp( r );
+	assert( rc->d_imp );
+	if( rc->d_imp->d_state == RecordImp::StateDeleted )
+		throw DatabaseException( DatabaseException::RecordDeleted );
+	if( rc->d_elems == 0 )
+	{
+		// Verzeichnis einmal pro Transaktion dekodieren; kodiert wird erst im Commit
+		QByteArray img;
+		getChunk( rc, 0, img );
+		rc->d_elems = new ElemList::Buffer();
+		rc->d_elems->d_indexed = ElemList::readDir( img, rc->d_elems->d_dir );
+		rc->d_elems->reindex();
+	}
+	return rc->d_elems;
+}
+
+QList<OID>* Transaction::editChildren( Record* r )
+{
+	d_inTxn = true;
+	RecordCow* rc = lockImp( r );
+	assert( rc->d_imp );
+	if( rc->d_imp->d_state == RecordImp::StateDeleted )
+		throw DatabaseException( DatabaseException::RecordDeleted );
+	if( !rc->d_bufChildren )
+	{
+		// Einmal pro Transaktion dekodieren; kodiert wird erst im Commit
+		QByteArray img;
+		getChunk( rc, ElemList::ChildList, img );
+		if( !ElemList::readChildList( img, rc->d_children ) )
+			return 0;
+		rc->d_bufChildren = true;
+	}
+	return &rc->d_children;
+}
+
 void Transaction::setField( Record* r, quint32 id, const Stream::DataCell& v )
 {
 	d_inTxn = true;
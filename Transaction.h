@@ -31,6 +31,7 @@
 #include <Sdb/Record.h>
 #include <Sdb/Globals.h>
 #include <Sdb/Exceptions.h>
+#include <Sdb/ElemList.h>
 
 namespace Sdb
 {
@@ -61,6 +62,9 @@ namespace Sdb
 		bool isActive() const { return d_inTxn; }
 
 		Orl getOrl( OID oid ) const;
+		// Ldt die Records in einem Durchgang in Oid-Reihenfolge in den Cache, damit folgende
+		// getObject etc. keinen Btree-Zugriff mehr brauchen. parallel..in Worker-Threads dekodieren
+		void prefetch( const QList<OID>&, bool parallel = false ) const;
 
 		Obj createObject( Atom type = 0 );
         Obj createObject( const QUuid&, Atom type = 0 );
@@ -91,11 +95,19 @@ namespace Sdb
 		friend class Qit;
 		friend class Rel;
 		friend class DbStream;
+		friend class ElemList;
 		// Implementation von Obj, Orl etc.
 		quint32 createQSlot( Record*, const Stream::DataCell& );
 		void getQSlot( Record*, quint32 nr, Stream::DataCell& ) const;
 		void getCell( Record*, const QList<Stream::DataCell>& key, Stream::DataCell& value ) const;
 		void setCell( Record*, const QList<Stream::DataCell>& key, const Stream::DataCell& value );
+		void getChunk( Record*, quint32 nr, QByteArray& ) const; // leer..nicht vorhanden
+		void setChunk( Record*, quint32 nr, const QByteArray& ); // leer..lschen
+		bool getChildren( Record*, QList<OID>& ) const; // false..nicht materialisiert
+		QList<OID>* editChildren( Record* ); // 0..nicht materialisiert; gepuffert bis zum Commit
+		const ElemList::Buffer* peekElems( Record* ) const; // 0..in dieser Transaktion unverndert
+		ElemList::Buffer* editElems( Record* ); // gepuffert bis zum Commit
+		bool hasPendingRels( OID obj ) const; // true..Relationsliste von obj in dieser Transaktion gendert
 		void getField( Record*, quint32 id, Stream::DataCell& ) const;
 		bool hasField( Record*, quint32 id ) const;
 		quint64 getIdField( Record*, quint32 id ) const; // Helper fr getField
@@ -108,10 +120,6 @@ namespace Sdb
 		RecordCow* lockImp( Record* ); 
 		bool loadStreamMeta( quint32, StreamMeta& ); // false..not found
 		void unlockStream( quint32 );
-		void removeFromIndex(quint64 id, const Record::Fields& all, quint32 atom,const Stream::DataCell&);
-		void removeFromIndex( quint64 id,const Record::Fields& all, const Record::Fields& focus );
-		void addToIndex( quint64 id, const Record::Fields& all, quint32 atom,const Stream::DataCell& );
-		void addToIndex( quint64 id, const Record::Fields& all, const Record::Fields& focus );
 		OID derefUuid( const QUuid& );
 		void dump( Record* );
 	private: // ganz privat